@@ -5,6 +5,8 @@
  **********************************/
 
 #include "Application.h"
+#include "Sweep.h"
+#include "PhaseTimer.h"
 
 void handler(int sig) {
 	void *array[10];
@@ -26,8 +28,15 @@ void handler(int sig) {
  **********************************/
 int main(int argc, char *argv[]) {
 	//signal(SIGSEGV, handler);
+	if ( argc == ARGS_COUNT + 1 && !strcmp(argv[1], "-sweep") ) {
+		// Run a whole parameter sweep in this process
+		Sweep sweep(argv[2]);
+		return sweep.run();
+	}
+
 	if ( argc != ARGS_COUNT ) {
 		cout<<"Configuration (i.e., *.conf) file File Required"<<endl;
+		cout<<"Usage: "<<argv[0]<<" <test.conf> | -sweep <sweep.conf>"<<endl;
 		return FAILURE;
 	}
 
@@ -45,27 +54,60 @@ int main(int argc, char *argv[]) {
  * Constructor of the Application class
  */
 Application::Application(char *infile) {
-	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	init();
+}
+
+/**
+ * Constructor of the Application class from ready-made parameters.
+ * The application takes ownership of params.
+ */
+Application::Application(Params *params) {
+	par = params;
+	init();
+}
+
+/**
+ * FUNCTION NAME: init
+ *
+ * DESCRIPTION: Create the network, the log and all the nodes
+ */
+void Application::init() {
+	int i;
+	nodeCount = 0;
+	liveMissing = 0;
+	deadPresent = 0;
+	runningRemoved = 0;
+	repeatedJoins = 0;
+	timerPeriod = 1;
+	scenarioCrashes = 0;
+	scenarioRestarts = 0;
+	restartedAt.assign(par->EN_GPSZ, -1);
+	rejoining = 0;
+	rejoined = 0;
+	rejoinTicks = 0;
+	rejoinMax = 0;
+	healedAt = -1;
+	healMsgs = 0;
+	healBytes = 0;
 	log = new Log(par);
 	en = new EmulNet(par);
-	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 
 	/*
 	 * Init all nodes
 	 */
+	mp1.create(par, en, log);
 	for( i = 0; i < par->EN_GPSZ; i++ ) {
-		Member *memberNode = new Member;
-		memberNode->inited = false;
-		Address *addressOfMemberNode = new Address();
-		Address joinaddr;
-		joinaddr = getjoinaddr();
-		addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
-		mp1[i] = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
-		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
-		delete addressOfMemberNode;
+		log->LOG(&(mp1.member(i)->addr), "APP");
+	}
+	reportedJoined.assign((size_t)par->EN_GPSZ * par->EN_GPSZ, false);
+	for( i = 0; i < par->EN_GPSZ; i++ ) {
+		mp1[i]->subscribe([this, i](const MemberEvent &e) { checkEvent(i, e); });
+	}
+	if ( !par->SCENARIO.empty() && scenario.load(par->SCENARIO.c_str(), par->EN_GPSZ) != SUCCESS ) {
+		fprintf(stderr, "Unable to load scenario %s\n", par->SCENARIO.c_str());
+		exit(1);
 	}
 }
 
@@ -75,10 +117,7 @@ Application::Application(char *infile) {
 Application::~Application() {
 	delete log;
 	delete en;
-	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
-		delete mp1[i];
-	}
-	free(mp1);
+	mp1.destroy();
 	delete par;
 }
 
@@ -93,15 +132,108 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
 
-	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
-		// Run the membership protocol
-		mp1Run();
-		// Fail some nodes
-		fail();
+	int start = 0;
+
+	#ifdef PHASE_TIMERS
+	PhaseProfile::current().reset(par->PERF_COUNTERS != 0);
+	#endif
+	if ( par->MEM_REPORT > 0 ) {
+		MemScope::enableHooks();
+	}
+
+	// Fast-forward to a checkpointed group instead of replaying its bootstrap
+	if ( !par->CHECKPOINT_LOAD.empty() ) {
+		struct timespec t0, t1;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if ( loadCheckpoint(par->CHECKPOINT_LOAD.c_str()) != SUCCESS ) {
+			fprintf(stderr, "Unable to resume from checkpoint %s\n", par->CHECKPOINT_LOAD.c_str());
+			exit(1);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		start = par->globaltime + 1;
+		if ( par->VERBOSE ) {
+			cout<<"Resumed at time "<<par->globaltime<<" from "<<par->CHECKPOINT_LOAD<<" in "
+				<<(t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6<<" ms"<<endl;
+		}
+	}
+
+	if ( !par->TRACE_REPLAY.empty() ) {
+		// Feed recorded traffic straight to the handlers instead of running the scenario
+		if ( replay(par->TRACE_REPLAY.c_str()) != SUCCESS ) {
+			fprintf(stderr, "Unable to replay trace %s\n", par->TRACE_REPLAY.c_str());
+			exit(1);
+		}
+	}
+	else if ( par->EVENT_DRIVEN ) {
+		runEvents(start);
+	}
+	else {
+		runTicks(start);
+	}
+
+	countViewErrors();
+
+	#ifdef PHASE_TIMERS
+	PhaseProfile::current().report(log, &mp1.member(0)->addr, par->globaltime, true);
+	#endif
+	if ( par->MEM_REPORT > 0 ) {
+		reportMemory(0, par->globaltime, true);
+	}
+
+	#ifdef DEBUGLOG
+	for( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+		Member *node = mp1.member(i);
+		log->LOG(&node->addr, "#STATSLOG# inbox waiting %u high water %u capacity %u",
+				node->mp1q.size(), node->mp1q.highWaterMark(), node->mp1q.capacity());
+	}
+	// Sample keys whose primary owner every live node agrees on; partial views give no owners
+	int agreed = 0, keys = par->PARTIAL_VIEW ? 0 : 100;
+	for( int k = 0; k < keys; k++ ) {
+		char key[16];
+		bool same = true, found = false;
+		Address first;
+		vector<Address> owner;
+		sprintf(key, "key%d", k);
+		for( i = 0; i <= par->EN_GPSZ-1 && same; i++ ) {
+			Member *node = mp1.member(i);
+			if ( node->bFailed || !node->inited || mp1[i]->owners(key, 1, owner) == 0 ) {
+				continue;
+			}
+			if ( !found ) {
+				first = owner[0];
+				found = true;
+			}
+			same = owner[0] == first;
+		}
+		agreed += same ? 1 : 0;
+	}
+	if ( keys > 0 ) {
+		log->LOG(&mp1.member(0)->addr, "#STATSLOG# ring agreement %d of %d keys", agreed, keys);
 	}
+	if ( par->RING_VNODES > 0 ) {
+		// each ring must follow its node's member list through joins and removals, and stay empty with partial views
+		int running = 0, matching = 0;
+		for( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+			if ( mp1.member(i)->inited && !mp1.member(i)->bFailed ) {
+				running++;
+				matching += mp1[i]->ringMatchesViews() ? 1 : 0;
+			}
+		}
+		log->LOG(&mp1.member(0)->addr, "#STATSLOG# ring matches views on %d of %d running nodes", matching, running);
+	}
+	// view churn, as in partial view mode, must not show up as members joining or leaving
+	log->LOG(&mp1.member(0)->addr, "#STATSLOG# events %lld removals of running members, %lld repeated joins",
+			runningRemoved, repeatedJoins);
+	if ( scenario.active() ) {
+		log->LOG(&mp1.member(0)->addr, "#STATSLOG# scenario %d crashes %d restarts", scenarioCrashes, scenarioRestarts);
+		log->LOG(&mp1.member(0)->addr, "#STATSLOG# rejoin %d full views after restart in %.1f ticks on average, %d at most, %d pending",
+				rejoined, rejoined > 0 ? (double)rejoinTicks / rejoined : 0.0, rejoinMax, rejoining);
+		if ( healedAt >= 0 ) {
+			reportHeal("still apart after");
+		}
+	}
+	#endif
 
 	// Clean up
 	en->ENcleanup();
@@ -113,6 +245,269 @@ int Application::run()
 	return SUCCESS;
 }
 
+/*
+ * Ticks at which fail() has something to do
+ */
+const int Application::failTimes[] = { 50, 100, 300 };
+
+/**
+ * FUNCTION NAME: scheduleDelivery
+ *
+ * DESCRIPTION: EmulNet callback, schedules the delivery of a message to node toid.
+ * 				Messages due at the same time share one delivery event.
+ * 				EmulNet serializes the calls; the event loop only pops between sends.
+ */
+void Application::scheduleDelivery(void *env, int toid, long long deliverAt) {
+	Application *app = (Application *)env;
+	int i = toid - 1;
+	if ( i < 0 || i >= app->par->EN_GPSZ || app->nextDelivery[i] == deliverAt ) {
+		return;
+	}
+	app->nextDelivery[i] = deliverAt;
+	app->events.schedule(deliverAt, MSG_DELIVERY, i);
+}
+
+/**
+ * FUNCTION NAME: runTicks
+ *
+ * DESCRIPTION: Run every node once per tick until TOTAL_RUNNING_TIME
+ */
+void Application::runTicks(int start) {
+	// As time runs along
+	for( par->globaltime = start; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
+		par->setsimtime((long long)par->globaltime * TICK_UNITS);
+		// Reclaim dead letters while no node sends or receives
+		en->ENgc();
+		{
+			PHASE_TIMER(PHASE_TICK);
+			// Run the membership protocol
+			mp1Run();
+			// Fail some nodes
+			fail();
+		}
+		#ifdef PHASE_TIMERS
+		if ( par->PHASE_REPORT > 0 && (par->globaltime + 1) % par->PHASE_REPORT == 0 ) {
+			PhaseProfile::current().report(log, &mp1.member(0)->addr, par->globaltime + 1, false);
+		}
+		#endif
+		if ( par->MEM_REPORT > 0 && (par->globaltime + 1) % par->MEM_REPORT == 0 ) {
+			reportMemory(par->globaltime + 1 - par->MEM_REPORT, par->globaltime + 1, false);
+		}
+
+		if ( par->globaltime == par->CHECKPOINT_AT && !par->CHECKPOINT_SAVE.empty() ) {
+			if ( saveCheckpoint(par->CHECKPOINT_SAVE.c_str()) != SUCCESS ) {
+				fprintf(stderr, "Unable to write checkpoint %s\n", par->CHECKPOINT_SAVE.c_str());
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: runEvents
+ *
+ * DESCRIPTION: Discrete-event replacement of the tick loop.
+ * 				A node is only touched when one of its timers expires or a message
+ * 				reaches it, and time jumps straight to the next pending event.
+ */
+void Application::runEvents(int start) {
+	int i;
+	long long end = (long long)TOTAL_RUNNING_TIME * TICK_UNITS;
+	long long from = (long long)start * TICK_UNITS;
+	unsigned long long processed = 0;
+
+	timerPeriod = max(1LL, llround(par->PROTOCOL_PERIOD * TICK_UNITS));
+	nextDelivery.assign(par->EN_GPSZ, -1);
+	nextTimer.assign(par->EN_GPSZ, -1);
+	en->ENsetNotify(scheduleDelivery, this);
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		Member *m = mp1.member(i);
+		long long at = llround(par->STEP_RATE * i * TICK_UNITS);
+		if ( at >= from ) {
+			events.schedule(at, NODE_START, i);
+		}
+		else if ( m->inited && !m->bFailed ) {
+			// Resumed from a checkpoint: pick up the node's messages and timer
+			events.schedule(from, MSG_DELIVERY, i);
+			armTimer(i, from);
+		}
+	}
+	if ( scenario.active() ) {
+		// one check at a time, each scheduling the next
+		if ( scenario.nextTick() >= 0 ) {
+			events.schedule((long long)max(scenario.nextTick(), start) * TICK_UNITS, FAIL_CHECK, -1);
+		}
+	}
+	else {
+		for ( i = 0; i < (int)(sizeof(failTimes) / sizeof(failTimes[0])); i++ ) {
+			if ( failTimes[i] >= start ) {
+				events.schedule((long long)failTimes[i] * TICK_UNITS, FAIL_CHECK, -1);
+			}
+		}
+	}
+	if ( par->CHECKPOINT_AT >= start && !par->CHECKPOINT_SAVE.empty() ) {
+		events.schedule((long long)(par->CHECKPOINT_AT + 1) * TICK_UNITS - 1, SIM_CHECKPOINT, -1);
+	}
+
+	while ( !events.empty() ) {
+		SimEvent e = events.pop();
+		if ( e.time >= end ) {
+			break;
+		}
+		if ( e.time / TICK_UNITS != par->globaltime ) {
+			par->setsimtime(e.time);
+			en->ENgc();
+		}
+		par->setsimtime(e.time);
+		processed++;
+
+		switch ( e.type ) {
+		case MSG_DELIVERY:
+			if ( nextDelivery[e.node] == e.time ) {
+				nextDelivery[e.node] = -1;
+			}
+			if ( mp1.member(e.node)->inited && !mp1.member(e.node)->bFailed ) {
+				mp1[e.node]->recvLoop();
+				mp1[e.node]->checkMessages();
+			}
+			break;
+		case NODE_START:
+			mp1[e.node]->nodeStart(JOINADDR, par->PORTNUM);
+			if ( par->VERBOSE ) {
+				cout<<e.node<<"-th introduced node is assigned with the address: "<<mp1.member(e.node)->addr.getAddress() << endl;
+			}
+			nodeCount += e.node;
+			// Pick up whatever reached the node before it was up
+			events.schedule(e.time, MSG_DELIVERY, e.node);
+			armTimer(e.node, e.time + timerPeriod);
+			break;
+		case NODE_TIMER:
+			// Messages arrive through their own delivery events.
+			// A failed node's timer is simply not rearmed, and one
+			// superseded by a restart is dropped.
+			if ( nextTimer[e.node] != e.time ) {
+				break;
+			}
+			nextTimer[e.node] = -1;
+			if ( !mp1.member(e.node)->bFailed ) {
+				mp1[e.node]->nodeLoop();
+				armTimer(e.node, e.time + timerPeriod);
+			}
+			break;
+		case FAIL_CHECK:
+			fail();
+			if ( scenario.active() ) {
+				long long next = scenario.nextTick() >= 0 ? (long long)scenario.nextTick() * TICK_UNITS : -1;
+				// check every tick while restarted nodes are still filling their views, or healed views still differ
+				if ( (rejoining > 0 || healedAt >= 0) && (next < 0 || next > e.time + TICK_UNITS) ) {
+					next = e.time + TICK_UNITS;
+				}
+				if ( next >= 0 ) {
+					events.schedule(next, FAIL_CHECK, -1);
+				}
+			}
+			break;
+		case SIM_CHECKPOINT:
+			if ( saveCheckpoint(par->CHECKPOINT_SAVE.c_str()) != SUCCESS ) {
+				fprintf(stderr, "Unable to write checkpoint %s\n", par->CHECKPOINT_SAVE.c_str());
+			}
+			break;
+		}
+	}
+
+	#ifdef DEBUGLOG
+	log->LOG(&mp1.member(0)->addr, "#STATSLOG# event engine processed %llu events", processed);
+	#endif
+	en->ENsetNotify(NULL, NULL);
+	par->setsimtime(end);
+}
+
+/**
+ * FUNCTION NAME: armTimer
+ *
+ * DESCRIPTION: Schedule node i's next protocol round in the event engine, replacing any pending one
+ */
+void Application::armTimer(int i, long long at) {
+	nextTimer[i] = at;
+	events.schedule(at, NODE_TIMER, i);
+}
+
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Feed the messages a recorded run delivered to the replayed nodes back
+ * 				into their queues, tick by tick, and time the handlers on them.
+ * 				Nodes start at their usual tick; whatever they send is counted and
+ * 				discarded, and their timers do not run.
+ */
+int Application::replay(const char *path) {
+	int i;
+	TraceReader reader;
+	TraceRecord rec;
+	const char *payload;
+	vector<bool> replayed(par->EN_GPSZ, par->REPLAY_NODES.empty());
+	vector<int> touched;
+	unsigned long long messages = 0;
+	long long handlerNs = 0;
+	struct timespec t0, t1;
+
+	if ( reader.open(path) != SUCCESS || reader.nodeCount() != par->EN_GPSZ ) {
+		return FAILURE;
+	}
+	for ( i = 0; i < (int)par->REPLAY_NODES.size(); i++ ) {
+		replayed[par->REPLAY_NODES[i] - 1] = true;
+	}
+	en->ENsetSink(true);
+
+	par->globaltime = -1;
+	bool more = reader.next(&rec, &payload);
+	while ( par->globaltime < TOTAL_RUNNING_TIME ) {
+		int tick = more ? (int)(rec.time / TICK_UNITS) : TOTAL_RUNNING_TIME;
+		if ( tick > par->globaltime ) {
+			// Let the nodes handle the tick that is over, then move on to the next one
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for ( i = 0; i < (int)touched.size(); i++ ) {
+				mp1[touched[i]]->checkMessages();
+			}
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			handlerNs += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+			touched.clear();
+			par->globaltime++;
+			par->setsimtime((long long)par->globaltime * TICK_UNITS);
+			for ( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+				if ( replayed[i] && par->getcurrtime() == mp1.startAt(i) ) {
+					mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+					nodeCount += i;
+				}
+			}
+			continue;
+		}
+		i = rec.to - 1;
+		if ( payload != NULL && i >= 0 && i < par->EN_GPSZ && replayed[i] && mp1.member(i)->inited ) {
+			par->setsimtime(rec.time);
+			char *elt = EmulNet::ENalloc(rec.size);
+			memcpy(elt, payload, rec.size);
+			mp1[i]->enqueue(elt, rec.size);
+			if ( find(touched.begin(), touched.end(), i) == touched.end() ) {
+				touched.push_back(i);
+			}
+			messages++;
+		}
+		more = reader.next(&rec, &payload);
+	}
+	en->ENsetSink(false);
+
+	double seconds = handlerNs / 1e9;
+	double rate = seconds > 0 ? messages / seconds : 0;
+	if ( par->VERBOSE ) {
+		cout<<"Replayed "<<messages<<" messages from "<<path<<" in "<<seconds * 1e3<<" ms, "<<rate<<" msgs/s"<<endl;
+	}
+	#ifdef DEBUGLOG
+	log->LOG(&mp1.member(0)->addr, "#STATSLOG# replay %llu messages in %.3f ms, %.0f msgs/s", messages, seconds * 1e3, rate);
+	#endif
+	return SUCCESS;
+}
+
 /**
  * FUNCTION NAME: mp1Run
  *
@@ -127,7 +522,7 @@ void Application::mp1Run() {
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
 		 */
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		if( par->getcurrtime() > mp1.startAt(i) && !(mp1.member(i)->bFailed) ) {
 			// Receive messages from the network and queue them
 			mp1[i]->recvLoop();
 		}
@@ -140,22 +535,24 @@ void Application::mp1Run() {
 		/*
 		 * Introduce nodes into the distributed system
 		 */
-		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
+		if( par->getcurrtime() == mp1.startAt(i) ) {
 			// introduce the ith node into the system at time STEPRATE*i
 			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
-			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+			if ( par->VERBOSE ) {
+				cout<<i<<"-th introduced node is assigned with the address: "<<mp1.member(i)->addr.getAddress() << endl;
+			}
 			nodeCount += i;
 		}
 
 		/*
 		 * Handle all the messages in your queue and send heartbeats
 		 */
-		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		else if( par->getcurrtime() > mp1.startAt(i) && !(mp1.member(i)->bFailed) ) {
 			// handle messages and send heartbeats
 			mp1[i]->nodeLoop();
 			#ifdef DEBUGLOG
 			if( (i == 0) && (par->globaltime % 500 == 0) ) {
-				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+				log->LOG(&mp1.member(i)->addr, "@@time=%d", par->getcurrtime());
 			}
 			#endif
 		}
@@ -173,25 +570,32 @@ void Application::mp1Run() {
 void Application::fail() {
 	int i, removed;
 
+	if ( scenario.active() ) {
+		runScenario();
+		checkRejoins();
+		checkHeal();
+		return;
+	}
+
 	// fail half the members at time t=400
 	if( par->DROP_MSG && par->getcurrtime() == 50 ) {
 		par->dropmsg = 1;
 	}
 
 	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
+		removed = (par->nextrand() % par->EN_GPSZ);
 		#ifdef DEBUGLOG
-		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
+		log->LOG(&mp1.member(removed)->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
-		mp1[removed]->getMemberNode()->bFailed = true;
+		mp1.member(removed)->bFailed = true;
 	}
 	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
+		removed = par->nextrand() % par->EN_GPSZ/2;
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
-			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
+			log->LOG(&mp1.member(i)->addr, "Node failed at time = %d", par->getcurrtime());
 			#endif
-			mp1[i]->getMemberNode()->bFailed = true;
+			mp1.member(i)->bFailed = true;
 		}
 	}
 
@@ -201,16 +605,485 @@ void Application::fail() {
 
 }
 
+/**
+ * FUNCTION NAME: runScenario
+ *
+ * DESCRIPTION: Carry out the scenario's steps due by now
+ */
+void Application::runScenario() {
+	int i, k, now = par->getcurrtime();
+
+	scenario.take(now, scenarioDue);
+	for ( k = 0; k < (int)scenarioDue.size(); k++ ) {
+		ScenarioEvent &e = scenarioDue[k];
+		switch ( e.type ) {
+		case SCN_CRASH:
+			i = e.node > 0 ? e.node - 1 : pickRunning();
+			if ( i >= 0 ) {
+				crashNode(i, e.downtime);
+			}
+			break;
+		case SCN_RACK: {
+			int racks = (par->EN_GPSZ + e.rackSize - 1) / e.rackSize;
+			int rack = e.node > 0 ? e.node - 1 : par->nextrand() % racks;
+			for ( i = rack * e.rackSize; i < min((rack + 1) * e.rackSize, par->EN_GPSZ); i++ ) {
+				crashNode(i, e.downtime);
+			}
+			break;
+		}
+		case SCN_RESTART:
+			restartNode(e.node - 1);
+			break;
+		case SCN_DROP:
+			par->MSG_DROP_PROB = e.prob;
+			par->dropmsg = e.prob > 0 ? 1 : 0;
+			break;
+		case SCN_PARTITION:
+			#ifdef DEBUGLOG
+			log->LOG(&mp1.member(scenario.side(e.cut, 0)[0] - 1)->addr, "Network partitioned at time=%d", now);
+			#endif
+			if ( healedAt >= 0 ) {
+				reportHeal("split again after");
+			}
+			en->ENpartition(scenario.side(e.cut, 0), scenario.side(e.cut, 1), e.oneway);
+			break;
+		case SCN_HEAL:
+			if ( !en->ENpartitioned() ) {
+				break;
+			}
+			#ifdef DEBUGLOG
+			log->LOG(&mp1.member(0)->addr, "Network healed at time=%d", now);
+			#endif
+			en->ENheal();
+			healedAt = now;
+			en->ENtraffic(&healMsgs, &healBytes);
+			break;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: pickRunning
+ *
+ * DESCRIPTION: Index of a node picked at random among those running, -1 if none is
+ */
+int Application::pickRunning() {
+	int i, running = 0;
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		running += (mp1.member(i)->inited && !mp1.member(i)->bFailed) ? 1 : 0;
+	}
+	if ( running == 0 ) {
+		return -1;
+	}
+	int k = par->nextrand() % running;
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( mp1.member(i)->inited && !mp1.member(i)->bFailed && k-- == 0 ) {
+			break;
+		}
+	}
+	return i;
+}
+
+/**
+ * FUNCTION NAME: crashNode
+ *
+ * DESCRIPTION: Stop node i if it is running, and have it restart downtime ticks later
+ * 				unless downtime is 0. Nodes that have not started yet are left alone.
+ */
+void Application::crashNode(int i, int downtime) {
+	Member *m = mp1.member(i);
+	if ( !m->inited || m->bFailed ) {
+		return;
+	}
+	#ifdef DEBUGLOG
+	log->LOG(&m->addr, "Node failed at time=%d", par->getcurrtime());
+	#endif
+	m->bFailed = true;
+	scenarioCrashes++;
+	if ( restartedAt[i] >= 0 ) {
+		restartedAt[i] = -1;
+		rejoining--;
+	}
+	if ( downtime > 0 ) {
+		ScenarioEvent e;
+		memset(&e, 0, sizeof(e));
+		e.at = par->getcurrtime() + downtime;
+		e.type = SCN_RESTART;
+		e.node = i + 1;
+		scenario.schedule(e);
+	}
+}
+
+/**
+ * FUNCTION NAME: restartNode
+ *
+ * DESCRIPTION: Bring crashed node i back under its address, with none of its old state
+ */
+void Application::restartNode(int i) {
+	Member *m = mp1.member(i);
+	if ( !m->bFailed ) {
+		return;
+	}
+	#ifdef DEBUGLOG
+	log->LOG(&m->addr, "Node restarted at time=%d", par->getcurrtime());
+	#endif
+	mp1[i]->restartNode(JOINADDR, par->PORTNUM);
+	fill(reportedJoined.begin() + (size_t)i * par->EN_GPSZ, reportedJoined.begin() + (size_t)(i + 1) * par->EN_GPSZ, false);
+	scenarioRestarts++;
+	restartedAt[i] = par->getcurrtime();
+	rejoining++;
+	if ( par->EVENT_DRIVEN ) {
+		events.schedule(par->simtime, MSG_DELIVERY, i);
+		armTimer(i, par->simtime + timerPeriod);
+	}
+}
+
+/**
+ * FUNCTION NAME: checkEvent
+ *
+ * DESCRIPTION: Check a membership event of node i against the ground truth: a member
+ * 				reported removed should have failed, and one reported joined should
+ * 				not have been reported so already
+ */
+void Application::checkEvent(int i, const MemberEvent &e) {
+	int j = e.id - 1;
+	if ( j < 0 || j >= par->EN_GPSZ ) {
+		return;
+	}
+	size_t k = (size_t)i * par->EN_GPSZ + j;
+	if ( e.type == EVENT_JOINED ) {
+		repeatedJoins += reportedJoined[k] ? 1 : 0;
+		reportedJoined[k] = true;
+	}
+	else if ( e.type == EVENT_REMOVED ) {
+		runningRemoved += mp1.member(j)->bFailed ? 0 : 1;
+		reportedJoined[k] = false;
+	}
+}
+
+/**
+ * FUNCTION NAME: checkRejoins
+ *
+ * DESCRIPTION: Time how long each restarted node takes to hold every running member
+ * 				of the group in its view again
+ */
+void Application::checkRejoins() {
+	int i, j;
+	if ( rejoining == 0 ) {
+		return;
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( restartedAt[i] < 0 ) {
+			continue;
+		}
+		MemberTable &view = mp1.member(i)->memberList;
+		bool full = mp1.member(i)->inGroup;
+		for ( j = 0; j < par->EN_GPSZ && full; j++ ) {
+			Member *other = mp1.member(j);
+			if ( other->inGroup && !other->bFailed ) {
+				full = view.find(*(int *)other->addr.addr, *(short *)&other->addr.addr[4]) >= 0;
+			}
+		}
+		if ( full ) {
+			int ticks = par->getcurrtime() - restartedAt[i];
+			rejoined++;
+			rejoinTicks += ticks;
+			rejoinMax = max(rejoinMax, ticks);
+			restartedAt[i] = -1;
+			rejoining--;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: checkHeal
+ *
+ * DESCRIPTION: Once the views agree again after a heal, report how long it took and what it cost
+ */
+void Application::checkHeal() {
+	if ( healedAt >= 0 && viewsAgree() ) {
+		reportHeal("converged after");
+	}
+}
+
+/**
+ * FUNCTION NAME: viewsAgree
+ *
+ * DESCRIPTION: Whether every running node is in the group and holds the same members,
+ * 				every running node among them. Partial views never match, so with them
+ * 				the active views must link every running node into one overlay instead.
+ */
+bool Application::viewsAgree() {
+	int i, j;
+	MemberTable *first = NULL;
+	if ( par->PARTIAL_VIEW ) {
+		return overlayConnected();
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		Member *m = mp1.member(i);
+		if ( !m->inited || m->bFailed ) {
+			continue;
+		}
+		if ( !m->inGroup ) {
+			return false;
+		}
+		if ( first == NULL ) {
+			first = &m->memberList;
+			continue;
+		}
+		if ( m->memberList.size() != first->size() ) {
+			return false;
+		}
+		for ( j = 0; j < first->size(); j++ ) {
+			if ( m->memberList.key(j) != first->key(j) ) {
+				return false;
+			}
+		}
+	}
+	for ( i = 0; i < par->EN_GPSZ && first != NULL; i++ ) {
+		Member *m = mp1.member(i);
+		if ( m->inited && !m->bFailed && first->find(*(int *)m->addr.addr, *(short *)&m->addr.addr[4]) < 0 ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: overlayConnected
+ *
+ * DESCRIPTION: Whether every running node is in the group and reachable from every other
+ * 				through links both ends hold in their active views
+ */
+bool Application::overlayConnected() {
+	int i, j, running = 0, reached = 0;
+	vector<vector<int> > links(par->EN_GPSZ);
+	vector<int> stack;
+	vector<bool> seen(par->EN_GPSZ, false);
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		Member *m = mp1.member(i);
+		if ( !m->inited || m->bFailed ) {
+			continue;
+		}
+		if ( !m->inGroup ) {
+			return false;
+		}
+		running++;
+		for ( j = 0; j < m->memberList.size(); j++ ) {
+			int peer = m->memberList.id(j) - 1;
+			// a peer taken in from the passive view is no link until it took us in too
+			if ( peer > i && peer < par->EN_GPSZ && mp1.member(peer)->inited && !mp1.member(peer)->bFailed
+					&& mp1.member(peer)->memberList.find(*(int *)m->addr.addr, *(short *)&m->addr.addr[4]) >= 0 ) {
+				links[i].push_back(peer);
+				links[peer].push_back(i);
+			}
+		}
+		if ( stack.empty() ) {
+			stack.push_back(i);
+			seen[i] = true;
+		}
+	}
+	while ( !stack.empty() ) {
+		i = stack.back();
+		stack.pop_back();
+		reached++;
+		for ( j = 0; j < (int)links[i].size(); j++ ) {
+			if ( !seen[links[i][j]] ) {
+				seen[links[i][j]] = true;
+				stack.push_back(links[i][j]);
+			}
+		}
+	}
+	return reached == running;
+}
+
+/**
+ * FUNCTION NAME: reportHeal
+ *
+ * DESCRIPTION: Log the ticks, messages and bytes since the last heal, and stop measuring it
+ */
+void Application::reportHeal(const char *outcome) {
+	unsigned long long msgs, bytes;
+	en->ENtraffic(&msgs, &bytes);
+	log->LOG(&mp1.member(0)->addr, "#STATSLOG# partition healed at %d: views %s %d ticks, %llu messages %llu bytes",
+			healedAt, outcome, par->getcurrtime() - healedAt, msgs - healMsgs, bytes - healBytes);
+	healedAt = -1;
+}
+
+/**
+ * FUNCTION NAME: reportMemory
+ *
+ * DESCRIPTION: Write each node's live bytes per structure and how fast it allocated
+ * 				since the last report, then the totals over all nodes. A node whose
+ * 				state grew at each of the last MEM_GROWTH_REPORTS reports is flagged
+ * 				with the structure that grew most. The final report covers the whole run.
+ */
+void Application::reportMemory(int from, int now, bool final) {
+	long long totals[MEM_STRUCTURES];
+	int ticks = max(1, now - from);
+	char line[512];
+	int i, s, len;
+
+	memset(totals, 0, sizeof(totals));
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		MemAccount &memory = mp1[i]->memoryAccount();
+		Address *addr = &mp1.member(i)->addr;
+		long long inFlight;
+		unsigned long long sent;
+		en->ENinFlight(i + 1, &inFlight, &sent);
+		memory.set(MEM_IN_FLIGHT, inFlight, sent);
+
+		unsigned long long allocated = 0;
+		for ( s = 0; s < MEM_STRUCTURES; s++ ) {
+			allocated += final ? memory.get((MemStructure)s).allocated : memory.allocatedSinceReport((MemStructure)s);
+			totals[s] += memory.get((MemStructure)s).live;
+		}
+		len = snprintf(line, sizeof(line), "#STATSLOG# mem node %d ticks %d-%d: live %lld B, %.1f B/tick allocated;",
+				i + 1, from, now, memory.tracked(), (double)allocated / ticks);
+		for ( s = 0; s < MEM_STRUCTURES && len < (int)sizeof(line); s++ ) {
+			len += snprintf(line + len, sizeof(line) - len, " %s %lld", MemAccount::name((MemStructure)s), memory.get((MemStructure)s).live);
+		}
+		log->LOG(addr, "%s", line);
+
+		MemStructure fastest;
+		long long growth;
+		if ( !final && memory.sample(par->MEM_GROWTH_REPORTS, &fastest, &growth) ) {
+			log->LOG(addr, "#STATSLOG# mem node %d keeps growing: live %lld B after %d reports, most from %s (+%lld B)",
+					i + 1, memory.tracked(), par->MEM_GROWTH_REPORTS, MemAccount::name(fastest), growth);
+		}
+	}
+	len = snprintf(line, sizeof(line), "#STATSLOG# mem all nodes ticks %d-%d:", from, now);
+	for ( s = 0; s < MEM_STRUCTURES && len < (int)sizeof(line); s++ ) {
+		len += snprintf(line + len, sizeof(line) - len, " %s %lld", MemAccount::name((MemStructure)s), totals[s]);
+	}
+	log->LOG(&mp1.member(0)->addr, "%s", line);
+}
+
+/**
+ * FUNCTION NAME: countViewErrors
+ *
+ * DESCRIPTION: Compare the final view of every live node against the ground truth
+ */
+void Application::countViewErrors() {
+	int i, j;
+	liveMissing = 0;
+	deadPresent = 0;
+	if ( par->PARTIAL_VIEW ) {
+		// Nobody holds the whole group: a live node is missing when no live node
+		// monitors it, a dead one is present while any live node still monitors it
+		set<int> covered;
+		for ( i = 0; i < par->EN_GPSZ; i++ ) {
+			Member *m = mp1.member(i);
+			if ( m->bFailed || !m->inited ) {
+				continue;
+			}
+			shared_ptr<const MembershipSnapshot> snap = mp1[i]->snapshot();
+			for ( j = 0; j < snap->size(); j++ ) {
+				if ( snap->members[j].id != *(int *)(m->addr.addr) ) {
+					covered.insert(snap->members[j].id);
+				}
+			}
+		}
+		for ( i = 0; i < par->EN_GPSZ; i++ ) {
+			Member *m = mp1.member(i);
+			int id = *(int *)(m->addr.addr);
+			if ( !m->bFailed && m->inited && covered.count(id) == 0 ) {
+				liveMissing++;
+			}
+			else if ( m->bFailed && covered.count(id) > 0 ) {
+				deadPresent++;
+			}
+		}
+		return;
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		Member *m = mp1.member(i);
+		if ( m->bFailed || !m->inited ) {
+			continue;
+		}
+		shared_ptr<const MembershipSnapshot> view = mp1[i]->snapshot();
+		for ( j = 0; j < par->EN_GPSZ; j++ ) {
+			Member *other = mp1.member(j);
+			int id = *(int *)(other->addr.addr);
+			bool present = view->contains(id, *(short *)&other->addr.addr[4]);
+			if ( other->bFailed && present ) {
+				deadPresent++;
+			}
+			else if ( !other->bFailed && other->inited && !present ) {
+				liveMissing++;
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: saveCheckpoint
+ *
+ * DESCRIPTION: Write the global time, every node and the in-flight messages to a checkpoint
+ */
+int Application::saveCheckpoint(const char *path) {
+	CheckpointWriter w;
+	int i;
+
+	if ( w.open(path) != SUCCESS ) {
+		return FAILURE;
+	}
+	w.put<int>(par->EN_GPSZ);
+	w.put<long long>(par->simtime);
+	w.put<int>(par->dropmsg);
+	w.put<double>(par->MSG_DROP_PROB);
+	w.put<unsigned int>(par->getrandstate());
+	w.put<int>(nodeCount);
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		mp1[i]->checkpoint(&w);
+	}
+	en->ENcheckpoint(&w);
+	scenario.checkpoint(&w);
+	return w.close();
+}
+
+/**
+ * FUNCTION NAME: loadCheckpoint
+ *
+ * DESCRIPTION: Restore the state written by saveCheckpoint.
+ * 				The checkpoint must come from a group of the same size.
+ */
+int Application::loadCheckpoint(const char *path) {
+	CheckpointReader r;
+	int i;
+
+	if ( r.open(path) != SUCCESS ) {
+		return FAILURE;
+	}
+	if ( r.get<int>() != par->EN_GPSZ ) {
+		return FAILURE;
+	}
+	par->setsimtime(r.get<long long>());
+	par->dropmsg = r.get<int>();
+	par->MSG_DROP_PROB = r.get<double>();
+	par->setrandstate(r.get<unsigned int>());
+	nodeCount = r.get<int>();
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( mp1[i]->restore(&r) != SUCCESS ) {
+			return FAILURE;
+		}
+	}
+	if ( en->ENrestore(&r) != SUCCESS ) {
+		return FAILURE;
+	}
+	return scenario.restore(&r);
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
- * DESCRIPTION: This function returns the address of the coordinator
+ * DESCRIPTION: This function returns the address of the coordinator, the first introducer
  */
 Address Application::getjoinaddr(void){
 	//trace.funcEntry("Application::getjoinaddr");
     Address joinaddr;
     joinaddr.init();
-    *(int *)(&(joinaddr.addr))=1;
+    *(int *)(&(joinaddr.addr))=par->INTRODUCERS[0];
     *(short *)(&(joinaddr.addr[4]))=0;
     //trace.funcExit("Application::getjoinaddr", SUCCESS);
     return joinaddr;
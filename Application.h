@@ -14,11 +14,9 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
-
-/**
- * global variables
- */
-int nodeCount = 0;
+#include "EventQueue.h"
+#include "NodeArena.h"
+#include "Scenario.h"
 
 /*
  * Macros
@@ -38,15 +36,76 @@ private:
 	char JOINADDR[30];
 	EmulNet *en;
     Log *log;
-	MP1Node **mp1;
+	// every node, laid out by index in one block
+	NodeArena mp1;
 	Params *par;
+	int nodeCount;
+	// live members missing from live views / failed members still in live views, at the end of run
+	int liveMissing;
+	int deadPresent;
+	// whether node i reported node j joined and not removed since, at i * EN_GPSZ + j, and
+	// the events that contradict it: removals of running members and joins reported twice
+	vector<bool> reportedJoined;
+	long long runningRemoved;
+	long long repeatedJoins;
+	// pending events and the last delivery time scheduled per node, for the event engine
+	static const int failTimes[];
+	EventQueue events;
+	vector<long long> nextDelivery;
+	// time of each node's live protocol timer in the event engine, -1 for none
+	vector<long long> nextTimer;
+	long long timerPeriod;
+	// failure and churn script replacing fail()'s fixed failures, and what it did so far
+	Scenario scenario;
+	vector<ScenarioEvent> scenarioDue;
+	int scenarioCrashes;
+	int scenarioRestarts;
+	// tick each restarted node came back at, until its view holds every running member, -1 otherwise
+	vector<int> restartedAt;
+	int rejoining;
+	// restarted nodes that got a full view, and the ticks it took them
+	int rejoined;
+	long long rejoinTicks;
+	int rejoinMax;
+	// tick of the last heal while the views it should bring back together still differ, -1 otherwise,
+	// and the messages and bytes sent by then
+	int healedAt;
+	unsigned long long healMsgs;
+	unsigned long long healBytes;
+	static void scheduleDelivery(void *env, int toid, long long deliverAt);
+	void checkEvent(int i, const MemberEvent &e);
+	void runTicks(int start);
+	void runEvents(int start);
+	void armTimer(int i, long long at);
+	void runScenario();
+	int pickRunning();
+	void crashNode(int i, int downtime);
+	void restartNode(int i);
+	void checkRejoins();
+	void checkHeal();
+	bool viewsAgree();
+	bool overlayConnected();
+	void reportHeal(const char *outcome);
+	int replay(const char *path);
+	void init();
+	void countViewErrors();
+	void reportMemory(int from, int now, bool final);
+	int saveCheckpoint(const char *path);
+	int loadCheckpoint(const char *path);
 public:
 	Application(char *);
+	Application(Params *);
 	virtual ~Application();
 	Address getjoinaddr();
 	int run();
 	void mp1Run();
 	void fail();
+	int getLiveMissing() {
+		return liveMissing;
+	}
+	int getDeadPresent() {
+		return deadPresent;
+	}
 };
 
 #endif /* _APPLICATION_H__ */
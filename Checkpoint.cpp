@@ -0,0 +1,90 @@
+/**********************************
+ * FILE NAME: Checkpoint.cpp
+ *
+ * DESCRIPTION: Definition of the simulation checkpoint writer and reader
+ **********************************/
+
+#include "Checkpoint.h"
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Create the checkpoint file and write its header
+ */
+int CheckpointWriter::open(const char *path) {
+	pos = 0;
+	failed = false;
+	if ( file.openWrite(path, 1 << 20) != SUCCESS ) {
+		return FAILURE;
+	}
+	put<unsigned long long>(CHECKPOINT_MAGIC);
+	put<int>(CHECKPOINT_VERSION);
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: putBytes
+ *
+ * DESCRIPTION: Append size bytes, doubling the mapping when it is full
+ */
+void CheckpointWriter::putBytes(const void *data, size_t size) {
+	if ( failed || size == 0 ) {
+		return;
+	}
+	if ( pos + size > file.size() ) {
+		size_t newLength = file.size();
+		while ( pos + size > newLength ) {
+			newLength *= 2;
+		}
+		if ( file.resize(newLength) != SUCCESS ) {
+			failed = true;
+			return;
+		}
+	}
+	memcpy(file.data() + pos, data, size);
+	pos += size;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Cut the file to the bytes written and unmap it
+ */
+int CheckpointWriter::close() {
+	if ( file.close(pos) != SUCCESS || failed ) {
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Map a checkpoint file and check its header
+ */
+int CheckpointReader::open(const char *path) {
+	pos = 0;
+	failed = false;
+	if ( file.openRead(path) != SUCCESS ) {
+		return FAILURE;
+	}
+	if ( get<unsigned long long>() != CHECKPOINT_MAGIC || get<int>() != CHECKPOINT_VERSION ) {
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: getBytes
+ *
+ * DESCRIPTION: Pointer to the next size bytes inside the mapping, NULL past the end
+ */
+const char *CheckpointReader::getBytes(size_t size) {
+	if ( failed || pos + size > file.size() ) {
+		failed = true;
+		return NULL;
+	}
+	const char *src = file.data() + pos;
+	pos += size;
+	return src;
+}
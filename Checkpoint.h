@@ -0,0 +1,72 @@
+/**********************************
+ * FILE NAME: Checkpoint.h
+ *
+ * DESCRIPTION: Header file of the simulation checkpoint writer and reader
+ **********************************/
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "stdincludes.h"
+#include "MappedFile.h"
+
+/*
+ * Macros
+ */
+#define CHECKPOINT_MAGIC 0x54504b43314d504dULL
+#define CHECKPOINT_VERSION 19
+
+/**
+ * CLASS NAME: CheckpointWriter
+ *
+ * DESCRIPTION: Appends raw simulation state to a memory-mapped file
+ */
+class CheckpointWriter {
+private:
+	MappedFile file;
+	size_t pos;
+	bool failed;
+public:
+	CheckpointWriter(): pos(0), failed(false) {}
+	virtual ~CheckpointWriter() {}
+	int open(const char *path);
+	void putBytes(const void *data, size_t size);
+	template <typename T> void put(const T &value) {
+		putBytes(&value, sizeof(T));
+	}
+	int close();
+};
+
+/**
+ * CLASS NAME: CheckpointReader
+ *
+ * DESCRIPTION: Reads simulation state back from a memory-mapped checkpoint.
+ * 				Reads past the end mark the reader bad instead of overrunning the mapping.
+ */
+class CheckpointReader {
+private:
+	MappedFile file;
+	size_t pos;
+	bool failed;
+public:
+	CheckpointReader(): pos(0), failed(false) {}
+	virtual ~CheckpointReader() {}
+	int open(const char *path);
+	const char *getBytes(size_t size);
+	template <typename T> T get() {
+		T value;
+		const char *src = getBytes(sizeof(T));
+		if ( src == NULL ) {
+			memset(&value, 0, sizeof(T));
+		}
+		else {
+			memcpy(&value, src, sizeof(T));
+		}
+		return value;
+	}
+	bool ok() {
+		return !failed;
+	}
+};
+
+#endif /* _CHECKPOINT_H_ */
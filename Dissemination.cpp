@@ -0,0 +1,148 @@
+/**********************************
+ * FILE NAME: Dissemination.cpp
+ *
+ * DESCRIPTION: Definition of the piggyback dissemination buffer
+ **********************************/
+
+#include "Dissemination.h"
+#include "Member.h"
+
+/**
+ * FUNCTION NAME: overrides
+ *
+ * DESCRIPTION: Whether update a about a member supersedes update b about the same member.
+ * 				A later incarnation wins over anything said of an earlier one. Within
+ * 				an incarnation death is final, a suspicion beats an alive update of the
+ * 				same heartbeat, and otherwise only a higher heartbeat wins.
+ */
+bool DisseminationBuffer::overrides(const MemberUpdate &a, const MemberUpdate &b) {
+	if ( a.incarnation != b.incarnation ) {
+		return newerIncarnation(a.incarnation, b.incarnation);
+	}
+	if ( b.type == UPDATE_DEAD ) {
+		return false;
+	}
+	if ( a.type == UPDATE_DEAD ) {
+		return true;
+	}
+	if ( a.type == UPDATE_SUSPECT && b.type != UPDATE_SUSPECT ) {
+		return a.heartbeat >= b.heartbeat;
+	}
+	return a.heartbeat > b.heartbeat;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Queue an update for piggybacking
+ *
+ * RETURNS:
+ * false if the buffer already holds the same or a stronger update about the member
+ */
+bool DisseminationBuffer::add(const MemberUpdate &u) {
+	for ( unsigned int i = 0; i < pending.size(); i++ ) {
+		if ( pending[i].update.id == u.id && pending[i].update.port == u.port ) {
+			if ( !overrides(u, pending[i].update) ) {
+				return false;
+			}
+			pending[i].update = u;
+			pending[i].sent = 0;
+			return true;
+		}
+	}
+	Pending p;
+	p.update = u;
+	p.sent = 0;
+	pending.push_back(p);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: select
+ *
+ * DESCRIPTION: Pick up to max updates for one message, the least sent first and,
+ * 				among those, the highest priority type. Updates sent limit times
+ * 				are dropped from the buffer.
+ *
+ * RETURNS:
+ * number of updates written to out
+ */
+int DisseminationBuffer::select(MemberUpdate *out, int max, int limit) {
+	int i, n = min(max, (int)pending.size());
+	if ( n <= 0 ) {
+		return 0;
+	}
+	// least sent first, then DEAD before SUSPECT before ALIVE before JOIN, then oldest
+	order.resize(pending.size());
+	for ( i = 0; i < (int)order.size(); i++ ) {
+		order[i] = make_pair(pending[i].sent * 4 + (UPDATE_DEAD - pending[i].update.type), i);
+	}
+	partial_sort(order.begin(), order.begin() + n, order.end());
+	for ( i = 0; i < n; i++ ) {
+		out[i] = pending[order[i].second].update;
+		pending[order[i].second].sent++;
+	}
+	unsigned int k = 0;
+	for ( unsigned int j = 0; j < pending.size(); j++ ) {
+		if ( pending[j].sent < limit ) {
+			pending[k++] = pending[j];
+		}
+	}
+	pending.resize(k);
+	return n;
+}
+
+/**
+ * FUNCTION NAME: requeue
+ *
+ * DESCRIPTION: Take back updates select picked for a message that was never sent:
+ * 				each still waiting counts one send less, and one dropped on
+ * 				reaching limit is kept for a last send.
+ */
+void DisseminationBuffer::requeue(const MemberUpdate *in, int n, int limit) {
+	for ( int i = 0; i < n; i++ ) {
+		unsigned int j = 0;
+		while ( j < pending.size() && (pending[j].update.id != in[i].id || pending[j].update.port != in[i].port) ) {
+			j++;
+		}
+		if ( j == pending.size() ) {
+			Pending p;
+			p.update = in[i];
+			p.sent = limit - 1;
+			pending.push_back(p);
+		}
+		else if ( pending[j].sent > 0 ) {
+			pending[j].sent--;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: checkpoint
+ *
+ * DESCRIPTION: Save the waiting updates and their send counts
+ */
+void DisseminationBuffer::checkpoint(CheckpointWriter *w) {
+	w->put<int>(pending.size());
+	for ( unsigned int i = 0; i < pending.size(); i++ ) {
+		w->put<MemberUpdate>(pending[i].update);
+		w->put<int>(pending[i].sent);
+	}
+}
+
+/**
+ * FUNCTION NAME: restore
+ *
+ * DESCRIPTION: Load the state saved by checkpoint
+ */
+int DisseminationBuffer::restore(CheckpointReader *r) {
+	int n = r->get<int>();
+	pending.clear();
+	for ( int i = 0; i < n && r->ok(); i++ ) {
+		Pending p;
+		p.update = r->get<MemberUpdate>();
+		p.sent = r->get<int>();
+		pending.push_back(p);
+	}
+	return r->ok() ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,64 @@
+/**********************************
+ * FILE NAME: Dissemination.h
+ *
+ * DESCRIPTION: Header file of the piggyback dissemination buffer
+ **********************************/
+
+#ifndef _DISSEMINATION_H_
+#define _DISSEMINATION_H_
+
+#include "stdincludes.h"
+#include "Checkpoint.h"
+
+/**
+ * Kinds of membership update, in increasing priority
+ */
+enum UpdateType {
+	UPDATE_JOIN,
+	UPDATE_ALIVE,
+	UPDATE_SUSPECT,
+	UPDATE_DEAD
+};
+
+/**
+ * STRUCT NAME: MemberUpdate
+ *
+ * DESCRIPTION: One membership update as it rides on a message
+ */
+typedef struct MemberUpdate {
+	int id;
+	short port;
+	char type;
+	unsigned char incarnation;
+	long heartbeat;
+} MemberUpdate;
+
+/**
+ * CLASS NAME: DisseminationBuffer
+ *
+ * DESCRIPTION: Membership updates waiting to be piggybacked on outgoing messages.
+ * 				Each update is sent a bounded number of times, the least sent and
+ * 				most important ones first, and at most one update per member is
+ * 				kept: a newer or stronger one replaces it and starts over.
+ */
+class DisseminationBuffer {
+private:
+	struct Pending {
+		MemberUpdate update;
+		int sent;
+	};
+	vector<Pending> pending;
+	// scratch (rank, index) pairs of select
+	vector<pair<int, int>> order;
+public:
+	static bool overrides(const MemberUpdate &a, const MemberUpdate &b);
+	bool add(const MemberUpdate &u);
+	int select(MemberUpdate *out, int max, int limit);
+	void requeue(const MemberUpdate *in, int n, int limit);
+	int size() const { return pending.size(); }
+	void clear() { pending.clear(); }
+	void checkpoint(CheckpointWriter *w);
+	int restore(CheckpointReader *r);
+};
+
+#endif /* _DISSEMINATION_H_ */
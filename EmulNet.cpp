@@ -5,40 +5,73 @@
  **********************************/
 
 #include "EmulNet.h"
+#include "PhaseTimer.h"
 
 /**
  * Constructor
  */
-EmulNet::EmulNet(Params *p)
+EmulNet::EmulNet(Params *p): links(p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
-	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
+	notify = NULL;
+	notifyenv = NULL;
+	sink = false;
+	if ( !par->TRACE_RECORD.empty() ) {
+		trace = make_shared<TraceWriter>();
+		if ( trace->open(par->TRACE_RECORD.c_str(), par->EN_GPSZ) != SUCCESS ) {
+			fprintf(stderr, "Unable to write trace %s\n", par->TRACE_RECORD.c_str());
+			trace.reset();
 		}
 	}
+	dropOverflow = 0;
+	dropLoss = 0;
+	dropBurst = 0;
+	dropQueue = 0;
+	dropFull = 0;
+	dropPartition = 0;
+	expired = 0;
+	deadLettered = 0;
+	for ( int i = 0; i <= par->EN_GPSZ; i++ ) {
+		inboxes.push_back(make_shared<en_inbox>(par->INBOX_CAPACITY));
+	}
+	lastRecv.assign(par->EN_GPSZ + 1, -1);
+	sendRand.resize(par->EN_GPSZ + 1);
+	for ( int i = 0; i <= par->EN_GPSZ; i++ ) {
+		sendRand[i] = par->SEED ^ ((i + 1) * 0x9e3779b9u);
+	}
+	// Only as many rows as this run has nodes, so small runs don't pay for MAX_NODES
+	sent_msgs.assign((par->EN_GPSZ + 1) * MAX_TIME, 0);
+	recv_msgs.assign((par->EN_GPSZ + 1) * MAX_TIME, 0);
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
 /**
  * Copy constructor
  */
-EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
+EmulNet::EmulNet(EmulNet &anotherEmulNet): links(anotherEmulNet.links) {
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->inboxes = anotherEmulNet.inboxes;
+	this->dropOverflow = anotherEmulNet.dropOverflow.load();
+	this->dropLoss = anotherEmulNet.dropLoss.load();
+	this->dropBurst = anotherEmulNet.dropBurst.load();
+	this->dropQueue = anotherEmulNet.dropQueue.load();
+	this->dropFull = anotherEmulNet.dropFull.load();
+	this->dropPartition = anotherEmulNet.dropPartition.load();
+	this->cuts = anotherEmulNet.cuts;
+	this->expired = anotherEmulNet.expired.load();
+	this->deadLettered = anotherEmulNet.deadLettered.load();
+	this->lastRecv = anotherEmulNet.lastRecv;
+	this->sendRand = anotherEmulNet.sendRand;
+	this->notify = anotherEmulNet.notify;
+	this->notifyenv = anotherEmulNet.notifyenv;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->trace = anotherEmulNet.trace;
+	this->sink = anotherEmulNet.sink;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +79,27 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->links = anotherEmulNet.links;
+	this->inboxes = anotherEmulNet.inboxes;
+	this->dropOverflow = anotherEmulNet.dropOverflow.load();
+	this->dropLoss = anotherEmulNet.dropLoss.load();
+	this->dropBurst = anotherEmulNet.dropBurst.load();
+	this->dropQueue = anotherEmulNet.dropQueue.load();
+	this->dropFull = anotherEmulNet.dropFull.load();
+	this->dropPartition = anotherEmulNet.dropPartition.load();
+	this->cuts = anotherEmulNet.cuts;
+	this->expired = anotherEmulNet.expired.load();
+	this->deadLettered = anotherEmulNet.deadLettered.load();
+	this->lastRecv = anotherEmulNet.lastRecv;
+	this->sendRand = anotherEmulNet.sendRand;
+	this->notify = anotherEmulNet.notify;
+	this->notifyenv = anotherEmulNet.notifyenv;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->trace = anotherEmulNet.trace;
+	this->sink = anotherEmulNet.sink;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -64,6 +109,18 @@ EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
  */
 EmulNet::~EmulNet() {}
 
+/**
+ * FUNCTION NAME: enLater
+ *
+ * DESCRIPTION: Heap order of an inbox's pending messages, the earliest delivery on top
+ */
+static bool enLater(const en_msg *a, const en_msg *b) {
+	if ( a->deliverAt != b->deliverAt ) {
+		return a->deliverAt > b->deliverAt;
+	}
+	return a->seq > b->seq;
+}
+
 /**
  * FUNCTION NAME: ENinit
  *
@@ -83,15 +140,51 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
  * DESCRIPTION: EmulNet send function
  *
  * RETURNS:
- * size
+ * size, 0 if the message was dropped, EN_BACKPRESSURE if the destination's inbox is full
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 	en_msg *em;
-	
-	static char temp[2048];
-	int sendmsg = rand() % 100;
+	en_inbox *in;
+	long long deliverAt;
+	int dst = *(int *)(toaddr->addr);
+	int src = *(int *)(myaddr->addr);
+	int time = par->getcurrtime();
+
+	if ( sink ) {
+		sent_msgs[src * MAX_TIME + time]++;
+		return size;
+	}
+
+	if( src < 0 || src > par->EN_GPSZ || dst < 0 || dst > par->EN_GPSZ || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) ) {
+		dropOverflow++;
+		ENtrace(TRACE_SEND, TRACE_OVERFLOW, src, dst, data, size);
+		return 0;
+	}
+	if ( !cuts.empty() && ENsevered(src, dst) ) {
+		dropPartition++;
+		ENtrace(TRACE_SEND, TRACE_PARTITION, src, dst, data, size);
+		return 0;
+	}
+	in = inboxes[dst].get();
+	if( in->ring.size() >= in->ring.capacity() ) {
+		dropFull++;
+		ENtrace(TRACE_SEND, TRACE_FULL, src, dst, data, size);
+		return EN_BACKPRESSURE;
+	}
+	if( par->dropmsg && rand_r(&sendRand[src]) % 100 < (int) (par->MSG_DROP_PROB * 100) ) {
+		dropLoss++;
+		ENtrace(TRACE_SEND, TRACE_LOSS, src, dst, data, size);
+		return 0;
+	}
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	switch ( links.transmit(*(int *)(myaddr->addr), *(int *)(toaddr->addr), size, par->simtime, &deliverAt) ) {
+	case LINK_BURST_LOSS:
+		dropBurst++;
+		ENtrace(TRACE_SEND, TRACE_BURST, src, dst, data, size);
+		return 0;
+	case LINK_QUEUE_DROP:
+		dropQueue++;
+		ENtrace(TRACE_SEND, TRACE_QUEUE, src, dst, data, size);
 		return 0;
 	}
 
@@ -100,21 +193,31 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 
 	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
 	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
-
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	memcpy((char *)(em + 1), data, size);
+	em->sentAt = par->simtime;
+	em->deliverAt = deliverAt;
+	em->seq = 0;
+
+	// Another sender may have taken the last slot since the check above
+	if ( !in->ring.push(em) ) {
+		free(em);
+		dropFull++;
+		ENtrace(TRACE_SEND, TRACE_FULL, src, dst, data, size);
+		return EN_BACKPRESSURE;
+	}
+	in->bytes += size;
+	in->total += size;
 
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
+	if ( notify != NULL ) {
+		lock_guard<mutex> guard(notifying);
+		(*notify)(notifyenv, dst, deliverAt);
+	}
+	ENtrace(TRACE_SEND, TRACE_OK, src, dst, data, size);
 
-	assert(src <= MAX_NODES);
+	assert(src <= par->EN_GPSZ);
 	assert(time < MAX_TIME);
 
-	sent_msgs[src][time]++;
-
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	sent_msgs[src * MAX_TIME + time]++;
 
 	return size;
 }
@@ -144,38 +247,278 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
  * 0
  */
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
+	PHASE_TIMER(PHASE_EN_RECV);
 	// times is always assumed to be 1
+	en_msg *emsg;
+	en_inbox *in;
+	long long now = par->simtime;
+	long long ttl = (long long)par->MSG_TTL * TICK_UNITS;
+	int dst = *(int *)(myaddr->addr);
+
+	if ( dst < 0 || dst > par->EN_GPSZ ) {
+		return 0;
+	}
+	lastRecv[dst] = now;
+
+	in = inboxes[dst].get();
+	ENdrain(in);
+	while ( !in->pending.empty() && in->pending.front()->deliverAt <= now ) {
+		pop_heap(in->pending.begin(), in->pending.end(), enLater);
+		emsg = in->pending.back();
+		in->pending.pop_back();
+		in->bytes -= emsg->size;
+
+		if ( ttl > 0 && now - emsg->sentAt > ttl ) {
+			expired++;
+			ENtrace(TRACE_RECV, TRACE_EXPIRED, *(int *)emsg->from.addr, dst, (char *)(emsg+1), emsg->size);
+			free(emsg);
+			continue;
+		}
+
+		ENtrace(TRACE_RECV, TRACE_OK, *(int *)emsg->from.addr, dst, (char *)(emsg+1), emsg->size);
+		// Hand the payload over in place; the receiver releases it with ENfree
+		(*enq)(queue, (char *)(emsg+1), emsg->size);
+
+		int time = par->getcurrtime();
+
+		assert(time < MAX_TIME);
+
+		recv_msgs[dst * MAX_TIME + time]++;
+	}
+
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENdrain
+ *
+ * DESCRIPTION: Move everything senders have pushed into an inbox onto its pending heap.
+ * 				Only the inbox's owner may call this.
+ */
+void EmulNet::ENdrain(en_inbox *in) {
+	en_msg *emsg;
+	while ( in->ring.pop(&emsg) ) {
+		emsg->seq = in->nextSeq++;
+		in->pending.push_back(emsg);
+		push_heap(in->pending.begin(), in->pending.end(), enLater);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENclear
+ *
+ * DESCRIPTION: Free every message still in an inbox
+ */
+void EmulNet::ENclear() {
+	for ( unsigned int i = 0; i < inboxes.size(); i++ ) {
+		en_inbox *in = inboxes[i].get();
+		ENdrain(in);
+		for ( unsigned int j = 0; j < in->pending.size(); j++ ) {
+			free(in->pending[j]);
+		}
+		in->pending.clear();
+		in->bytes = 0;
+	}
+}
+
+/**
+ * FUNCTION NAME: ENalloc
+ *
+ * DESCRIPTION: Allocate a payload of size bytes laid out like a received message,
+ * 				so it can be queued alongside them and released with ENfree
+ */
+char *EmulNet::ENalloc(int size) {
+	en_msg *emsg = (en_msg *) malloc(sizeof(en_msg) + size);
+	emsg->size = size;
+	return (char *)(emsg+1);
+}
+
+/**
+ * FUNCTION NAME: ENfree
+ *
+ * DESCRIPTION: Release a payload handed out by ENrecv or ENalloc
+ */
+void EmulNet::ENfree(char *data) {
+	if ( data != NULL ) {
+		free((en_msg *)data - 1);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENgc
+ *
+ * DESCRIPTION: Reclaim in-flight messages that can no longer be useful:
+ * 				those older than MSG_TTL, and those that have been due for
+ * 				DEAD_LETTER_TICKS on a destination that stopped receiving
+ * 				(e.g. a failed node). It drains other nodes' inboxes, so the
+ * 				engine calls it once per tick, while no node sends or receives.
+ */
+void EmulNet::ENgc() {
 	int i;
-	char* tmp;
-	int sz;
+	unsigned int j, kept;
+	long long now = par->simtime;
+	long long ttl = (long long)par->MSG_TTL * TICK_UNITS;
+	long long silence = (long long)par->DEAD_LETTER_TICKS * TICK_UNITS;
+	long long quiet = silence > 0 ? silence : ttl;
 	en_msg *emsg;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+	if ( ttl <= 0 && silence <= 0 ) {
+		return;
+	}
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	// A node that keeps receiving reclaims its own expired messages in ENrecv, so only
+	// visit the silent ones. Their owners are not draining, so GC drains for them.
+	for( i = 0; i <= par->EN_GPSZ; i++ ) {
+		if ( now - lastRecv[i] <= quiet ) {
+			continue;
+		}
+		en_inbox *in = inboxes[i].get();
+		ENdrain(in);
+
+		kept = 0;
+		for( j = 0; j < in->pending.size(); j++ ) {
+			emsg = in->pending[j];
+			if ( ttl > 0 && now - emsg->sentAt > ttl ) {
+				expired++;
+				ENtrace(TRACE_RECV, TRACE_EXPIRED, *(int *)emsg->from.addr, i, (char *)(emsg+1), emsg->size);
+				in->bytes -= emsg->size;
+				free(emsg);
+			}
+			else if ( silence > 0 && now - emsg->deliverAt > silence ) {
+				deadLettered++;
+				ENtrace(TRACE_RECV, TRACE_DEAD_LETTER, *(int *)emsg->from.addr, i, (char *)(emsg+1), emsg->size);
+				in->bytes -= emsg->size;
+				free(emsg);
+			}
+			else {
+				in->pending[kept++] = emsg;
+			}
+		}
+		if ( kept != in->pending.size() ) {
+			in->pending.resize(kept);
+			make_heap(in->pending.begin(), in->pending.end(), enLater);
+		}
+	}
+}
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+/**
+ * FUNCTION NAME: ENsetNotify
+ *
+ * DESCRIPTION: Register the function told about the destination and delivery time of every accepted message
+ */
+void EmulNet::ENsetNotify(void (*notify)(void *, int, long long), void *env) {
+	this->notify = notify;
+	this->notifyenv = env;
+}
 
-			(*enq)(queue, (char *)tmp, sz);
+/**
+ * FUNCTION NAME: ENsetSink
+ *
+ * DESCRIPTION: In sink mode sends are only counted, for replaying a trace without the network
+ */
+void EmulNet::ENsetSink(bool on) {
+	sink = on;
+}
 
-			free(emsg);
+/**
+ * FUNCTION NAME: ENinFlight
+ *
+ * DESCRIPTION: Payload bytes on their way to a node, and all accepted for it so far
+ */
+void EmulNet::ENinFlight(int id, long long *live, unsigned long long *total) {
+	*live = 0;
+	*total = 0;
+	if ( id >= 0 && id < (int)inboxes.size() ) {
+		*live = inboxes[id]->bytes.load();
+		*total = inboxes[id]->total.load();
+	}
+}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+/**
+ * FUNCTION NAME: ENtraffic
+ *
+ * DESCRIPTION: Messages and payload bytes accepted for delivery since the start
+ */
+void EmulNet::ENtraffic(unsigned long long *msgs, unsigned long long *bytes) {
+	*msgs = 0;
+	*bytes = 0;
+	for ( unsigned int i = 0; i < sent_msgs.size(); i++ ) {
+		*msgs += sent_msgs[i];
+	}
+	for ( unsigned int i = 0; i < inboxes.size(); i++ ) {
+		*bytes += inboxes[i]->total.load();
+	}
+}
+
+/**
+ * FUNCTION NAME: ENpartition
+ *
+ * DESCRIPTION: Cut the links between node ids from and to, to being every other node when empty,
+ * 				in both directions unless oneway
+ */
+void EmulNet::ENpartition(const vector<int> &from, const vector<int> &to, bool oneway) {
+	en_cut cut;
+	unsigned int i;
+	cut.side.assign(par->EN_GPSZ + 1, to.empty() ? 2 : 0);
+	cut.oneway = oneway;
+	for ( i = 0; i < to.size(); i++ ) {
+		if ( to[i] > 0 && to[i] <= par->EN_GPSZ ) {
+			cut.side[to[i]] = 2;
+		}
+	}
+	for ( i = 0; i < from.size(); i++ ) {
+		if ( from[i] > 0 && from[i] <= par->EN_GPSZ ) {
+			cut.side[from[i]] = 1;
+		}
+	}
+	cuts.push_back(cut);
+}
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: ENheal
+ *
+ * DESCRIPTION: Lift every partition
+ */
+void EmulNet::ENheal() {
+	cuts.clear();
+}
 
-			recv_msgs[dst][time]++;
+/**
+ * FUNCTION NAME: ENsevered
+ *
+ * DESCRIPTION: Whether a partition cuts the link from node id src to node id dst
+ */
+bool EmulNet::ENsevered(int src, int dst) {
+	for ( unsigned int i = 0; i < cuts.size(); i++ ) {
+		int from = cuts[i].side[src], to = cuts[i].side[dst];
+		if ( (from == 1 && to == 2) || (!cuts[i].oneway && from == 2 && to == 1) ) {
+			return true;
 		}
 	}
+	return false;
+}
 
-	return 0;
+/**
+ * FUNCTION NAME: ENtrace
+ *
+ * DESCRIPTION: Record a send or a receive in the trace, if one is being recorded
+ */
+void EmulNet::ENtrace(TraceEvent event, TraceOutcome outcome, int from, int to, const char *data, int size) {
+	if ( !trace ) {
+		return;
+	}
+	TraceRecord rec;
+	memset(&rec, 0, sizeof(TraceRecord));
+	rec.time = par->simtime;
+	rec.from = from;
+	rec.to = to;
+	if ( size >= (int)sizeof(int) ) {
+		memcpy(&rec.type, data, sizeof(int));
+	}
+	rec.size = size;
+	rec.event = event;
+	rec.outcome = outcome;
+	trace->append(rec, data);
 }
 
 /**
@@ -188,11 +531,9 @@ int EmulNet::ENcleanup() {
 	int i, j;
 	int sent_total, recv_total;
 
-	FILE* file = fopen("msgcount.log", "w+");
+	FILE* file = fopen(par->outpath("msgcount.log").c_str(), "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
-	}
+	ENclear();
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
@@ -201,22 +542,190 @@ int EmulNet::ENcleanup() {
 
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			sent_total += sent_msgs[i * MAX_TIME + j];
+			recv_total += recv_msgs[i * MAX_TIME + j];
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent_msgs[i * MAX_TIME + j], recv_msgs[i * MAX_TIME + j]);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i * MAX_TIME + j], recv_msgs[i * MAX_TIME + j]);
 			}
 		}
 		fprintf(file, "\n");
 		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
 	}
+	fprintf(file, "dropped overflow %ld loss %ld burst %ld queue %ld full %ld partition %ld\n",
+			dropOverflow.load(), dropLoss.load(), dropBurst.load(), dropQueue.load(), dropFull.load(), dropPartition.load());
+	fprintf(file, "reclaimed expired %ld dead_letter %ld\n", expired.load(), deadLettered.load());
 
 	fclose(file);
+	if ( trace && trace->close() != SUCCESS ) {
+		fprintf(stderr, "Unable to write trace %s\n", par->TRACE_RECORD.c_str());
+	}
 	return 0;
 }
+
+/**
+ * FUNCTION NAME: writeMsg
+ *
+ * DESCRIPTION: Save one in-flight message with its header
+ */
+static void writeMsg(CheckpointWriter *w, en_msg *emsg) {
+	w->putBytes(emsg, sizeof(en_msg) + emsg->size);
+}
+
+/**
+ * FUNCTION NAME: readMsg
+ *
+ * DESCRIPTION: Load one in-flight message saved by writeMsg
+ *
+ * RETURNS:
+ * the message, NULL if the checkpoint is truncated or corrupt
+ */
+static en_msg *readMsg(CheckpointReader *r, int maxSize) {
+	// messages are saved back to back, so the header is copied out before it is read
+	en_msg hdr;
+	const char *saved = r->getBytes(sizeof(en_msg));
+	if ( saved == NULL ) {
+		return NULL;
+	}
+	memcpy((char *)&hdr, saved, sizeof(en_msg));
+	if ( hdr.size < 0 || hdr.size > maxSize ) {
+		return NULL;
+	}
+	en_msg *em = (en_msg *)malloc(sizeof(en_msg) + hdr.size);
+	memcpy((char *)em, saved, sizeof(en_msg));
+	const char *payload = r->getBytes(em->size);
+	if ( payload == NULL ) {
+		free(em);
+		return NULL;
+	}
+	memcpy((char *)(em + 1), payload, em->size);
+	return em;
+}
+
+/**
+ * FUNCTION NAME: ENcheckpoint
+ *
+ * DESCRIPTION: Save the in-flight messages, the message and byte counters and the link state.
+ * 				Inboxes are saved as they are, so no sender may be running.
+ */
+void EmulNet::ENcheckpoint(CheckpointWriter *w) {
+	unsigned int i, j;
+	w->put<int>(emulnet.nextid);
+	w->put<int>(inboxes.size());
+	for ( i = 0; i < inboxes.size(); i++ ) {
+		en_inbox *in = inboxes[i].get();
+		w->put<unsigned long long>(in->nextSeq);
+		w->put<unsigned long long>(in->total.load());
+		w->put<int>(in->ring.size());
+		for ( j = 0; j < in->ring.size(); j++ ) {
+			writeMsg(w, in->ring.at(j));
+		}
+		// in heap order, so restoring needs no reordering
+		w->put<int>(in->pending.size());
+		for ( j = 0; j < in->pending.size(); j++ ) {
+			writeMsg(w, in->pending[j]);
+		}
+	}
+	w->put<int>(sent_msgs.size());
+	w->putBytes(sent_msgs.data(), sent_msgs.size() * sizeof(int));
+	w->putBytes(recv_msgs.data(), recv_msgs.size() * sizeof(int));
+	w->put<long>(dropOverflow);
+	w->put<long>(dropLoss);
+	w->put<long>(dropBurst);
+	w->put<long>(dropQueue);
+	w->put<long>(dropFull);
+	w->put<long>(dropPartition);
+	w->put<int>(cuts.size());
+	for ( i = 0; i < cuts.size(); i++ ) {
+		w->put<bool>(cuts[i].oneway);
+		w->putBytes(cuts[i].side.data(), cuts[i].side.size());
+	}
+	w->put<long>(expired);
+	w->put<long>(deadLettered);
+	w->putBytes(lastRecv.data(), lastRecv.size() * sizeof(long long));
+	w->putBytes(sendRand.data(), sendRand.size() * sizeof(unsigned int));
+	links.checkpoint(w);
+}
+
+/**
+ * FUNCTION NAME: ENrestore
+ *
+ * DESCRIPTION: Replace the in-flight messages and counters by those of a checkpoint
+ */
+int EmulNet::ENrestore(CheckpointReader *r) {
+	int i, j, n;
+	en_msg *em;
+	ENclear();
+	emulnet.nextid = r->get<int>();
+	if ( r->get<int>() != (int)inboxes.size() ) {
+		return FAILURE;
+	}
+	for ( i = 0; i < (int)inboxes.size(); i++ ) {
+		en_inbox *in = inboxes[i].get();
+		in->nextSeq = r->get<unsigned long long>();
+		in->total = r->get<unsigned long long>();
+		n = r->get<int>();
+		for ( j = 0; j < n && r->ok(); j++ ) {
+			if ( (em = readMsg(r, par->MAX_MSG_SIZE)) == NULL ) {
+				return FAILURE;
+			}
+			if ( !in->ring.push(em) ) {
+				free(em);
+				return FAILURE;
+			}
+			in->bytes += em->size;
+		}
+		n = r->get<int>();
+		for ( j = 0; j < n && r->ok(); j++ ) {
+			if ( (em = readMsg(r, par->MAX_MSG_SIZE)) == NULL ) {
+				return FAILURE;
+			}
+			in->pending.push_back(em);
+			in->bytes += em->size;
+		}
+	}
+	n = r->get<int>();
+	if ( n != (int)sent_msgs.size() ) {
+		return FAILURE;
+	}
+	const char *sent = r->getBytes(n * sizeof(int));
+	const char *recv = r->getBytes(n * sizeof(int));
+	if ( sent == NULL || recv == NULL ) {
+		return FAILURE;
+	}
+	memcpy(sent_msgs.data(), sent, n * sizeof(int));
+	memcpy(recv_msgs.data(), recv, n * sizeof(int));
+	dropOverflow = r->get<long>();
+	dropLoss = r->get<long>();
+	dropBurst = r->get<long>();
+	dropQueue = r->get<long>();
+	dropFull = r->get<long>();
+	dropPartition = r->get<long>();
+	cuts.assign(max(0, r->get<int>()), en_cut());
+	for ( i = 0; i < (int)cuts.size() && r->ok(); i++ ) {
+		cuts[i].oneway = r->get<bool>();
+		const char *side = r->getBytes(par->EN_GPSZ + 1);
+		if ( side == NULL ) {
+			return FAILURE;
+		}
+		cuts[i].side.assign(side, side + par->EN_GPSZ + 1);
+	}
+	expired = r->get<long>();
+	deadLettered = r->get<long>();
+	const char *last = r->getBytes(lastRecv.size() * sizeof(long long));
+	if ( last == NULL ) {
+		return FAILURE;
+	}
+	memcpy(lastRecv.data(), last, lastRecv.size() * sizeof(long long));
+	const char *streams = r->getBytes(sendRand.size() * sizeof(unsigned int));
+	if ( streams == NULL ) {
+		return FAILURE;
+	}
+	memcpy(sendRand.data(), streams, sendRand.size() * sizeof(unsigned int));
+	return links.restore(r);
+}
@@ -9,11 +9,17 @@
 
 #define MAX_NODES 1000
 #define MAX_TIME 3600
-#define ENBUFFSIZE 30000
+// ENsend return value when the destination's inbox is full
+#define EN_BACKPRESSURE -1
 
 #include "stdincludes.h"
+#include <memory>
 #include "Params.h"
 #include "Member.h"
+#include "Queue.h"
+#include "Checkpoint.h"
+#include "LinkModel.h"
+#include "Trace.h"
 
 using namespace std;
 
@@ -27,47 +33,60 @@ typedef struct en_msg {
 	Address from;
 	// Destination node
 	Address to;
+	// Simulation time (in TICK_UNITS) the message was sent at
+	long long sentAt;
+	// Simulation time (in TICK_UNITS) from which the message can be received
+	long long deliverAt;
+	// Order of arrival at the destination, breaks ties between equal deliverAt
+	unsigned long long seq;
 }en_msg;
 
+/**
+ * Struct Name: en_inbox
+ *
+ * DESCRIPTION: Messages on their way to one node. Senders push into ring from
+ * 				any thread; only the owner moves them into pending, a heap
+ * 				ordered by delivery time, and takes them out when due.
+ */
+typedef struct en_inbox {
+	MpscQueue<en_msg *> ring;
+	vector<en_msg *> pending;
+	unsigned long long nextSeq;
+	// payload bytes on their way to the node, and all accepted for it since the start
+	atomic<long long> bytes;
+	atomic<unsigned long long> total;
+	en_inbox(unsigned int capacity) : ring(capacity), nextSeq(0), bytes(0), total(0) {}
+}en_inbox;
+
+/**
+ * Struct Name: en_cut
+ *
+ * DESCRIPTION: A network partition: side is 1 or 2 for each node id on either side of it,
+ * 				0 for nodes it leaves alone. Messages between the sides are lost, only
+ * 				those from side 1 to side 2 when oneway is set.
+ */
+typedef struct en_cut {
+	vector<unsigned char> side;
+	bool oneway;
+}en_cut;
+
 /**
  * Class Name: EM
  */
 class EM {
 public:
 	int nextid;
-	int currbuffsize;
-	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
-		this->currbuffsize = anotherEM.getCurrBuffSize();
-		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
 		return *this;
 	}
 	int getNextId() {
 		return nextid;
 	}
-	int getCurrBuffSize() {
-		return currbuffsize;
-	}
-	int getFirstEltIndex() {
-		return firsteltindex;
-	}
 	void setNextId(int nextid) {
 		this->nextid = nextid;
 	}
-	void settCurrBuffSize(int currbuffsize) {
-		this->currbuffsize = currbuffsize;
-	}
-	void setFirstEltIndex(int firsteltindex) {
-		this->firsteltindex = firsteltindex;
-	}
 	virtual ~EM() {}
 };
 
@@ -80,10 +99,45 @@ class EmulNet
 { 	
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// per node message counters, (EN_GPSZ + 1) rows of MAX_TIME ticks. A row of sent_msgs
+	// is only written by its node's sends, and a row of recv_msgs by its node's receives.
+	vector<int> sent_msgs;
+	vector<int> recv_msgs;
 	int enInited;
 	EM emulnet;
+	LinkModel links;
+	// one inbox per node id, shared by copies of this EmulNet
+	vector<shared_ptr<en_inbox>> inboxes;
+	// random stream of each sender's loss decisions, indexed by node id, so senders share none
+	vector<unsigned int> sendRand;
+	// messages refused by ENsend: oversized or unknown destination, random loss, burst loss,
+	// full send backlog, full destination inbox, partitioned link
+	atomic<long> dropOverflow;
+	atomic<long> dropLoss;
+	atomic<long> dropBurst;
+	atomic<long> dropQueue;
+	atomic<long> dropFull;
+	atomic<long> dropPartition;
+	// partitions in force, changed only between ticks
+	vector<en_cut> cuts;
+	// in-flight messages reclaimed past MSG_TTL, and due messages reclaimed from silent destinations
+	atomic<long> expired;
+	atomic<long> deadLettered;
+	// time (in TICK_UNITS) each node last received, indexed by node id, -1 for never
+	vector<long long> lastRecv;
+	void ENdrain(en_inbox *in);
+	void ENclear();
+	bool ENsevered(int src, int dst);
+	// Told about every accepted message, so an event engine can schedule its delivery.
+	// Concurrent senders call it one at a time, under notifying.
+	void (*notify)(void *env, int toid, long long deliverAt);
+	void *notifyenv;
+	mutex notifying;
+	// every send and receive is appended here when TRACE_RECORD is set
+	shared_ptr<TraceWriter> trace;
+	// replay mode: sends are counted and discarded
+	bool sink;
+	void ENtrace(TraceEvent event, TraceOutcome outcome, int from, int to, const char *data, int size);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -93,7 +147,19 @@ public:
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	static char *ENalloc(int size);
+	static void ENfree(char *data);
 	int ENcleanup();
+	void ENgc();
+	void ENsetNotify(void (*notify)(void *, int, long long), void *env);
+	void ENsetSink(bool on);
+	void ENinFlight(int id, long long *live, unsigned long long *total);
+	void ENtraffic(unsigned long long *msgs, unsigned long long *bytes);
+	void ENpartition(const vector<int> &from, const vector<int> &to, bool oneway);
+	void ENheal();
+	bool ENpartitioned() const { return !cuts.empty(); }
+	void ENcheckpoint(CheckpointWriter *w);
+	int ENrestore(CheckpointReader *r);
 };
 
 #endif /* _EMULNET_H_ */
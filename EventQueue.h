@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: EventQueue.h
+ *
+ * DESCRIPTION: Header file of the discrete-event simulation queue
+ **********************************/
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#include "stdincludes.h"
+
+/**
+ * Event types, in the order they run when due at the same time
+ */
+enum SimEventType {
+	MSG_DELIVERY,
+	NODE_START,
+	NODE_TIMER,
+	FAIL_CHECK,
+	SIM_CHECKPOINT
+};
+
+/**
+ * STRUCT NAME: SimEvent
+ *
+ * DESCRIPTION: A message delivery or timer expiration due at time (in TICK_UNITS)
+ */
+typedef struct SimEvent {
+	long long time;
+	unsigned long long seq;
+	enum SimEventType type;
+	int node;
+} SimEvent;
+
+/**
+ * CLASS NAME: LaterEvent
+ *
+ * DESCRIPTION: Orders the heap so that the earliest event is on top.
+ * 				Ties are broken by event type and then by scheduling order.
+ */
+class LaterEvent {
+public:
+	bool operator()(const SimEvent &a, const SimEvent &b) const {
+		if ( a.time != b.time ) {
+			return a.time > b.time;
+		}
+		if ( a.type != b.type ) {
+			return a.type > b.type;
+		}
+		return a.seq > b.seq;
+	}
+};
+
+/**
+ * CLASS NAME: EventQueue
+ *
+ * DESCRIPTION: Priority queue of pending simulation events
+ */
+class EventQueue {
+private:
+	priority_queue<SimEvent, vector<SimEvent>, LaterEvent> heap;
+	unsigned long long nextseq;
+public:
+	EventQueue(): nextseq(0) {}
+	virtual ~EventQueue() {}
+	void schedule(long long time, enum SimEventType type, int node) {
+		SimEvent e;
+		e.time = time;
+		e.seq = nextseq++;
+		e.type = type;
+		e.node = node;
+		heap.push(e);
+	}
+	bool empty() {
+		return heap.empty();
+	}
+	size_t size() {
+		return heap.size();
+	}
+	SimEvent pop() {
+		SimEvent e = heap.top();
+		heap.pop();
+		return e;
+	}
+};
+
+#endif /* _EVENTQUEUE_H_ */
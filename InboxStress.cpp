@@ -0,0 +1,257 @@
+/**********************************
+ * FILE NAME: InboxStress.cpp
+ *
+ * DESCRIPTION: Multi-producer stress check of the lock-free inbox: MpscQueue
+ * 				under concurrent push and pop, and ENsend from several sender
+ * 				threads into one node. Built and run by "make check".
+ **********************************/
+
+#include "stdincludes.h"
+#include "Queue.h"
+#include "EmulNet.h"
+#include <thread>
+
+/*
+ * Macros
+ */
+#define STRESS_PRODUCERS 4
+#define STRESS_PUSHES 200000
+#define STRESS_CAPACITY 64
+#define STRESS_ROUNDS 200
+#define STRESS_SENDS 40
+
+/**
+ * STRUCT NAME: StressMsg
+ *
+ * DESCRIPTION: Payload of a stress message: who sent it and its number among that sender's sends
+ */
+typedef struct StressMsg {
+	int src;
+	int seq;
+} StressMsg;
+
+/**
+ * FUNCTION NAME: mpscConcurrent
+ *
+ * DESCRIPTION: Producers push numbered values while the consumer pops them. Every
+ * 				producer's values must come out once each, in the order it pushed them.
+ */
+static int mpscConcurrent() {
+	MpscQueue<unsigned long long> queue(STRESS_CAPACITY);
+	vector<thread> producers;
+	atomic<long> refused(0);
+	vector<int> next(STRESS_PRODUCERS, 0);
+	unsigned long long v;
+	long received = 0;
+	int errors = 0;
+
+	for ( int p = 0; p < STRESS_PRODUCERS; p++ ) {
+		producers.push_back(thread([&queue, &refused, p]() {
+			for ( int i = 0; i < STRESS_PUSHES; i++ ) {
+				while ( !queue.push((unsigned long long)p << 32 | i) ) {
+					refused++;
+					this_thread::yield();
+				}
+			}
+		}));
+	}
+	while ( received < (long)STRESS_PRODUCERS * STRESS_PUSHES ) {
+		if ( !queue.pop(&v) ) {
+			this_thread::yield();
+			continue;
+		}
+		int p = (int)(v >> 32);
+		int i = (int)(v & 0xffffffff);
+		if ( p < 0 || p >= STRESS_PRODUCERS || i != next[p] ) {
+			if ( errors++ < 10 ) {
+				fprintf(stderr, "MpscQueue: got value %d of producer %d, expected %d\n", i, p, p >= 0 && p < STRESS_PRODUCERS ? next[p] : -1);
+			}
+			continue;
+		}
+		next[p]++;
+		received++;
+	}
+	for ( unsigned int p = 0; p < producers.size(); p++ ) {
+		producers[p].join();
+	}
+	if ( queue.pop(&v) || queue.size() != 0 ) {
+		fprintf(stderr, "MpscQueue: values left after every push was popped\n");
+		errors++;
+	}
+	printf("MpscQueue concurrent: %ld values from %d producers, %ld pushes refused while full\n", received, STRESS_PRODUCERS, refused.load());
+	return errors == 0 ? SUCCESS : FAILURE;
+}
+
+/**
+ * FUNCTION NAME: mpscFull
+ *
+ * DESCRIPTION: Producers push more values than fit and nobody pops. Exactly capacity
+ * 				pushes must succeed, and all of those values must come out once.
+ */
+static int mpscFull() {
+	MpscQueue<unsigned long long> queue(STRESS_CAPACITY);
+	vector<thread> producers;
+	atomic<int> accepted(0);
+	set<unsigned long long> seen;
+	unsigned long long v;
+	int errors = 0;
+
+	for ( int p = 0; p < STRESS_PRODUCERS; p++ ) {
+		producers.push_back(thread([&queue, &accepted, p]() {
+			for ( int i = 0; i < STRESS_CAPACITY; i++ ) {
+				if ( queue.push((unsigned long long)p << 32 | i) ) {
+					accepted++;
+				}
+			}
+		}));
+	}
+	for ( unsigned int p = 0; p < producers.size(); p++ ) {
+		producers[p].join();
+	}
+	if ( accepted.load() != (int)queue.capacity() || queue.size() != queue.capacity() ) {
+		fprintf(stderr, "MpscQueue: %d pushes accepted into a queue of %u\n", accepted.load(), queue.capacity());
+		errors++;
+	}
+	while ( queue.pop(&v) ) {
+		if ( !seen.insert(v).second ) {
+			fprintf(stderr, "MpscQueue: value %llx popped twice\n", v);
+			errors++;
+		}
+	}
+	if ( (int)seen.size() != accepted.load() ) {
+		fprintf(stderr, "MpscQueue: %d pushes accepted, %d popped\n", accepted.load(), (int)seen.size());
+		errors++;
+	}
+	printf("MpscQueue full: %d of %d pushes accepted\n", accepted.load(), STRESS_PRODUCERS * STRESS_CAPACITY);
+	return errors == 0 ? SUCCESS : FAILURE;
+}
+
+/**
+ * FUNCTION NAME: collect
+ *
+ * DESCRIPTION: ENrecv callback gathering the delivered payloads
+ */
+static int collect(void *env, char *data, int size) {
+	vector<StressMsg> *got = (vector<StressMsg> *)env;
+	if ( size == (int)sizeof(StressMsg) ) {
+		StressMsg m;
+		memcpy(&m, data, sizeof(StressMsg));
+		got->push_back(m);
+	}
+	else {
+		got->push_back(StressMsg{-1, -1});
+	}
+	EmulNet::ENfree(data);
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: enSenders
+ *
+ * DESCRIPTION: Every round, one thread per sender node sends more messages to
+ * 				the last node than its inbox holds. Exactly INBOX_CAPACITY sends
+ * 				must be accepted, the rest refused with EN_BACKPRESSURE, and the
+ * 				next tick must deliver each accepted message once.
+ */
+static int enSenders() {
+	Params par;
+	par.MAX_NNB = STRESS_PRODUCERS + 1;
+	par.INBOX_CAPACITY = STRESS_CAPACITY;
+	par.MSG_TTL = 0;
+	par.DEAD_LETTER_TICKS = 0;
+	par.SEED = 1;
+	par.finalize();
+	EmulNet en(&par);
+	Address dst;
+	long accepted = 0, refused = 0, delivered = 0;
+	int errors = 0;
+
+	*(int *)dst.addr = par.EN_GPSZ;
+	*(short *)&dst.addr[4] = 0;
+
+	for ( int round = 0; round < STRESS_ROUNDS; round++ ) {
+		vector<thread> senders;
+		vector<vector<int>> sent(STRESS_PRODUCERS + 1);
+		atomic<int> roundAccepted(0), roundRefused(0), other(0);
+		vector<StressMsg> got;
+
+		for ( int src = 1; src <= STRESS_PRODUCERS; src++ ) {
+			senders.push_back(thread([&, src]() {
+				Address from;
+				*(int *)from.addr = src;
+				*(short *)&from.addr[4] = 0;
+				for ( int i = 0; i < STRESS_SENDS; i++ ) {
+					StressMsg m = { src, round * STRESS_SENDS + i };
+					Address to = dst;
+					int ret = en.ENsend(&from, &to, (char *)&m, sizeof(m));
+					if ( ret == (int)sizeof(m) ) {
+						sent[src].push_back(m.seq);
+						roundAccepted++;
+					}
+					else if ( ret == EN_BACKPRESSURE ) {
+						roundRefused++;
+					}
+					else {
+						other++;
+					}
+				}
+			}));
+		}
+		for ( unsigned int i = 0; i < senders.size(); i++ ) {
+			senders[i].join();
+		}
+		if ( roundAccepted.load() != STRESS_CAPACITY || other.load() != 0 ) {
+			fprintf(stderr, "ENsend: round %d accepted %d of %d sends into an inbox of %d, %d otherwise dropped\n",
+					round, roundAccepted.load(), STRESS_PRODUCERS * STRESS_SENDS, STRESS_CAPACITY, other.load());
+			errors++;
+		}
+
+		par.setsimtime(par.simtime + TICK_UNITS);
+		en.ENrecv(&dst, collect, NULL, 1, &got);
+
+		set<pair<int, int>> expected, seen;
+		for ( int src = 1; src <= STRESS_PRODUCERS; src++ ) {
+			for ( unsigned int i = 0; i < sent[src].size(); i++ ) {
+				expected.insert(make_pair(src, sent[src][i]));
+			}
+		}
+		for ( unsigned int i = 0; i < got.size(); i++ ) {
+			pair<int, int> key = make_pair(got[i].src, got[i].seq);
+			if ( !expected.count(key) || !seen.insert(key).second ) {
+				fprintf(stderr, "ENsend: round %d delivered message %d of node %d %s\n",
+						round, got[i].seq, got[i].src, expected.count(key) ? "twice" : "that was never accepted");
+				errors++;
+			}
+		}
+		if ( seen.size() != expected.size() ) {
+			fprintf(stderr, "ENsend: round %d lost %d accepted messages\n", round, (int)(expected.size() - seen.size()));
+			errors++;
+		}
+		accepted += roundAccepted.load();
+		refused += roundRefused.load();
+		delivered += got.size();
+		if ( errors > 10 ) {
+			break;
+		}
+	}
+	printf("ENsend: %ld sends from %d threads accepted, %ld pushed back, %ld delivered\n", accepted, STRESS_PRODUCERS, refused, delivered);
+	return errors == 0 ? SUCCESS : FAILURE;
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Run every check, fail if any of them does
+ **********************************/
+int main(int argc, char *argv[]) {
+	int failed = 0;
+	failed += mpscConcurrent() != SUCCESS;
+	failed += mpscFull() != SUCCESS;
+	failed += enSenders() != SUCCESS;
+	if ( failed ) {
+		fprintf(stderr, "%d inbox checks failed\n", failed);
+		return 1;
+	}
+	printf("All inbox checks passed\n");
+	return 0;
+}
@@ -0,0 +1,158 @@
+/**********************************
+ * FILE NAME: LinkModel.cpp
+ *
+ * DESCRIPTION: Definition of the emulated link impairment model
+ **********************************/
+
+#include "LinkModel.h"
+
+/**
+ * Constructor
+ */
+LinkModel::LinkModel(Params *p): par(p) {
+	senders.resize(par->EN_GPSZ + 1);
+	for ( unsigned int i = 0; i < senders.size(); i++ ) {
+		// a stream of its own per sender, apart from EmulNet's
+		senders[i].rand = par->SEED ^ ((i + 1) * 0x85ebca6bu);
+		senders[i].nextFree = 0;
+	}
+	burstLossOn = par->GE_P_GOOD_BAD > 0 || par->GE_LOSS_GOOD > 0;
+}
+
+/*
+ * Next number of a sender's random stream, scaled to [0, 1)
+ */
+static double uniform(LinkSender &s) {
+	return rand_r(&s.rand) / ((double)RAND_MAX + 1);
+}
+
+/**
+ * FUNCTION NAME: sampleLatency
+ *
+ * DESCRIPTION: Draw the latency of one message from the link's distribution, in TICK_UNITS
+ */
+long long LinkModel::sampleLatency(LinkSender &s, int from, int to) {
+	double latency = par->LINK_LATENCY;
+	double jitter = par->LINK_JITTER;
+	double u, v;
+	unsigned int i;
+
+	for ( i = 0; i < par->LINKS.size(); i++ ) {
+		LinkSpec *l = &par->LINKS[i];
+		if ( (l->from == 0 || l->from == from) && (l->to == 0 || l->to == to) ) {
+			latency = l->latency;
+			jitter = l->jitter;
+			break;
+		}
+	}
+
+	if ( jitter > 0 ) {
+		switch ( par->JITTER_DIST ) {
+		case JITTER_NORMAL:
+			// Box-Muller
+			u = 1.0 - uniform(s);
+			v = uniform(s);
+			latency += jitter * sqrt(-2.0 * log(u)) * cos(2 * M_PI * v);
+			break;
+		case JITTER_EXPONENTIAL:
+			latency += -jitter * log(1.0 - uniform(s));
+			break;
+		default:
+			latency += jitter * (2 * uniform(s) - 1);
+			break;
+		}
+	}
+
+	long long units = llround(latency * TICK_UNITS);
+	return units > 0 ? units : 1;
+}
+
+/**
+ * FUNCTION NAME: burstLoss
+ *
+ * DESCRIPTION: Step the link's Gilbert-Elliott chain and decide whether this message is lost
+ */
+bool LinkModel::burstLoss(LinkSender &s, int to) {
+	set<int>::iterator it = s.badLinks.find(to);
+	bool bad = it != s.badLinks.end();
+
+	if ( bad && uniform(s) < par->GE_P_BAD_GOOD ) {
+		s.badLinks.erase(it);
+		bad = false;
+	}
+	else if ( !bad && uniform(s) < par->GE_P_GOOD_BAD ) {
+		s.badLinks.insert(to);
+		bad = true;
+	}
+	return uniform(s) < (bad ? par->GE_LOSS_BAD : par->GE_LOSS_GOOD);
+}
+
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Put a message of size bytes from node from on the link to node to at time now.
+ * 				Only the state of from's links changes, so different senders may call this at once.
+ *
+ * RETURNS:
+ * a LinkResult, and the delivery time in *deliverAt for LINK_DELIVER
+ */
+int LinkModel::transmit(int from, int to, int size, long long now, long long *deliverAt) {
+	long long departure = now;
+	LinkSender &s = senders[from];
+
+	if ( par->NODE_BANDWIDTH > 0 && from > 0 ) {
+		// The message waits behind the sender's backlog, then occupies its uplink
+		departure = max(now, s.nextFree);
+		if ( par->NODE_QUEUE_TICKS > 0 && departure - now > par->NODE_QUEUE_TICKS * TICK_UNITS ) {
+			return LINK_QUEUE_DROP;
+		}
+		departure += llround(size * TICK_UNITS / par->NODE_BANDWIDTH);
+		s.nextFree = departure;
+	}
+
+	if ( burstLossOn && burstLoss(s, to) ) {
+		return LINK_BURST_LOSS;
+	}
+
+	*deliverAt = departure + sampleLatency(s, from, to);
+	return LINK_DELIVER;
+}
+
+/**
+ * FUNCTION NAME: checkpoint
+ *
+ * DESCRIPTION: Save each sender's random stream, uplink backlog and bad links
+ */
+void LinkModel::checkpoint(CheckpointWriter *w) {
+	w->put<int>(senders.size());
+	for ( unsigned int i = 0; i < senders.size(); i++ ) {
+		w->put<unsigned int>(senders[i].rand);
+		w->put<long long>(senders[i].nextFree);
+		w->put<int>(senders[i].badLinks.size());
+		for ( set<int>::iterator it = senders[i].badLinks.begin(); it != senders[i].badLinks.end(); it++ ) {
+			w->put<int>(*it);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: restore
+ *
+ * DESCRIPTION: Load the state saved by checkpoint
+ */
+int LinkModel::restore(CheckpointReader *r) {
+	int i, j, n = r->get<int>();
+	if ( n != (int)senders.size() ) {
+		return FAILURE;
+	}
+	for ( i = 0; i < n && r->ok(); i++ ) {
+		senders[i].rand = r->get<unsigned int>();
+		senders[i].nextFree = r->get<long long>();
+		senders[i].badLinks.clear();
+		int bad = r->get<int>();
+		for ( j = 0; j < bad && r->ok(); j++ ) {
+			senders[i].badLinks.insert(r->get<int>());
+		}
+	}
+	return r->ok() ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,60 @@
+/**********************************
+ * FILE NAME: LinkModel.h
+ *
+ * DESCRIPTION: Header file of the emulated link impairment model
+ **********************************/
+
+#ifndef _LINKMODEL_H_
+#define _LINKMODEL_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Checkpoint.h"
+
+/**
+ * Outcome of putting a message on a link
+ */
+enum LinkResult {
+	LINK_DELIVER,
+	LINK_BURST_LOSS,
+	LINK_QUEUE_DROP
+};
+
+/**
+ * STRUCT NAME: LinkSender
+ *
+ * DESCRIPTION: Link state of one sending node, touched only by its own sends,
+ * 				so that nodes sending from different threads share none
+ */
+typedef struct LinkSender {
+	// random stream for the sender's jitter and burst loss
+	unsigned int rand;
+	// time (in TICK_UNITS) at which the uplink is free again
+	long long nextFree;
+	// destinations whose link from this sender is in the Gilbert-Elliott bad state
+	set<int> badLinks;
+} LinkSender;
+
+/**
+ * CLASS NAME: LinkModel
+ *
+ * DESCRIPTION: Per-link latency and jitter, per-node send bandwidth with
+ * 				a bounded backlog, and Gilbert-Elliott burst loss
+ */
+class LinkModel {
+private:
+	Params *par;
+	// state of each node's outgoing links, indexed by node id
+	vector<LinkSender> senders;
+	bool burstLossOn;
+	long long sampleLatency(LinkSender &s, int from, int to);
+	bool burstLoss(LinkSender &s, int to);
+public:
+	LinkModel(Params *p);
+	virtual ~LinkModel() {}
+	int transmit(int from, int to, int size, long long now, long long *deliverAt);
+	void checkpoint(CheckpointWriter *w);
+	int restore(CheckpointReader *r);
+};
+
+#endif /* _LINKMODEL_H_ */
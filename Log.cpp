@@ -5,6 +5,7 @@
  **********************************/
 
 #include "Log.h"
+#include "PhaseTimer.h"
 
 /**
  * Constructor
@@ -12,6 +13,11 @@
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	fp = NULL;
+	fp2 = NULL;
+	numwrites = 0;
+	dbg_opened = false;
+	stdstring[0] = 0;
 }
 
 /**
@@ -19,7 +25,12 @@ Log::Log(Params *p) {
  */
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
-	this->firstTime = anotherLog.firstTime;
+	this->firstTime = false;
+	this->fp = NULL;
+	this->fp2 = NULL;
+	this->numwrites = 0;
+	this->dbg_opened = false;
+	this->stdstring[0] = 0;
 }
 
 /**
@@ -27,14 +38,18 @@ Log::Log(const Log &anotherLog) {
  */
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
-	this->firstTime = anotherLog.firstTime;
 	return *this;
 }
 
 /**
  * Destructor
  */
-Log::~Log() {}
+Log::~Log() {
+	if ( dbg_opened ) {
+		fclose(fp);
+		fclose(fp2);
+	}
+}
 
 /**
  * FUNCTION NAME: LOG
@@ -42,31 +57,21 @@ Log::~Log() {}
  * DESCRIPTION: Print out to file dbg.log, along with Address of node.
  */
 void Log::LOG(Address *addr, const char * str, ...) {
+	PHASE_TIMER(PHASE_LOG);
 
-	static FILE *fp;
-	static FILE *fp2;
 	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
-	static int dbg_opened=0;
-
-	if(dbg_opened != 639){
-		numwrites=0;
-
-		stdstring2[0]=0;
 
-		strcpy(stdstring3, stdstring2);
-
-		strcat(stdstring2, DBG_LOG);
-		strcat(stdstring3, STATS_LOG);
+	if(!dbg_opened){
+		numwrites=0;
 
-		fp = fopen(stdstring2, "w");
-		fp2 = fopen(stdstring3, "w");
+		fp = fopen(par->outpath(DBG_LOG).c_str(), "w");
+		fp2 = fopen(par->outpath(STATS_LOG).c_str(), "w");
+		if ( fp == NULL || fp2 == NULL ) {
+			fprintf(stderr, "Unable to open log files in '%s'\n", par->OUTDIR.c_str());
+			exit(1);
+		}
 
-		dbg_opened=639;
+		dbg_opened=true;
 	}
 	else 
 
@@ -114,7 +119,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -125,7 +130,7 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -29,6 +29,12 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	FILE *fp;
+	FILE *fp2;
+	int numwrites;
+	bool dbg_opened;
+	char buffer[30000];
+	char stdstring[30];
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -7,17 +7,40 @@
 
 #include "MP1Node.h"
 #include <sstream>
+#include "PhaseTimer.h"
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
 
+/**
+ * FUNCTION NAME: nodeSeed
+ *
+ * DESCRIPTION: Seed of a node's protocol random stream: splitmix64 of the run seed,
+ * 				the node id and a stream tag. EmulNet's sendRand and LinkModel's
+ * 				per-sender streams are seeded with SEED ^ (id + 1) * multiplier, so
+ * 				the node's draws must not reuse either formula.
+ */
+static unsigned int nodeSeed(unsigned int seed, int id)
+{
+    unsigned long long x = ((unsigned long long)seed << 32 | (unsigned int)id) ^ 0x4d50314e6f6465ULL;
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (unsigned int)((x ^ (x >> 31)) >> 32);
+}
+
 /**
  * Overloaded Constructor of the MP1Node class
  * You can add new members to the class if you think it
  * is necessary for your logic to work
  */
-MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Address *address)
+MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Address *address) :
+    deadNodes(CountingAllocator<MemberKey>(memory.counter(MEM_TOMBSTONES))),
+    deadTimes(CountingAllocator<long>(memory.counter(MEM_TOMBSTONES))),
+    deadIncarnations(CountingAllocator<unsigned char>(memory.counter(MEM_TOMBSTONES))),
+    reportedNodes(CountingAllocator<MemberKey>(memory.counter(MEM_PASSIVE_VIEW))),
+    events(params->EVENT_RING), ring(params->RING_VNODES)
 {
     for (int i = 0; i < 6; i++)
     {
@@ -28,6 +51,16 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
     this->log = log;
     this->par = params;
     this->memberNode->addr = *address;
+    this->digestVersion = (unsigned long)-1;
+    this->joinAttempts = 0;
+    this->nextJoinAt = 0;
+    this->congestedAt = -1;
+    this->incarnation = 0;
+    this->randState = nodeSeed(par->SEED, *(int *)address->addr);
+    this->viewVersion = (unsigned long)-1;
+    this->eventsLost.store(0);
+    this->memberNode->memberList.account(memory.counter(MEM_MEMBER_LIST));
+    this->passiveView.account(memory.counter(MEM_PASSIVE_VIEW));
 }
 
 /**
@@ -35,6 +68,22 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
  */
 MP1Node::~MP1Node() {}
 
+/**
+ * FUNCTION NAME: publishView
+ *
+ * DESCRIPTION: Publish a new membership snapshot if members joined or left
+ * 				since the last one; heartbeat updates alone don't republish
+ */
+void MP1Node::publishView()
+{
+    if (viewVersion == memberNode->memberList.membershipChanges())
+    {
+        return;
+    }
+    view.publish(make_shared<const MembershipSnapshot>(memberNode->memberList, par->getcurrtime()));
+    viewVersion = memberNode->memberList.membershipChanges();
+}
+
 /**
  * FUNCTION NAME: recvLoop
  *
@@ -43,13 +92,15 @@ MP1Node::~MP1Node() {}
  */
 int MP1Node::recvLoop()
 {
+    PHASE_TIMER(PHASE_RECV_LOOP);
+    MemScope scope(memory.counter(MEM_HEAP));
     if (memberNode->bFailed)
     {
         return false;
     }
     else
     {
-        return emulNet->ENrecv(&(memberNode->addr), enqueueWrapper, NULL, 1, &(memberNode->mp1q));
+        return emulNet->ENrecv(&(memberNode->addr), enqueueWrapper, NULL, 1, this);
     }
 }
 
@@ -60,8 +111,19 @@ int MP1Node::recvLoop()
  */
 int MP1Node::enqueueWrapper(void *env, char *buff, int size)
 {
-    Queue q;
-    return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+    ((MP1Node *)env)->enqueue(buff, size);
+    return true;
+}
+
+/**
+ * FUNCTION NAME: enqueue
+ *
+ * DESCRIPTION: Queue a received message in mp1q, charging it to the inbox until it is handled
+ */
+void MP1Node::enqueue(char *data, int size)
+{
+    Queue::enqueue(&memberNode->mp1q, (void *)data, size);
+    memory.counter(MEM_INBOX)->add(size);
 }
 
 /**
@@ -73,6 +135,7 @@ int MP1Node::enqueueWrapper(void *env, char *buff, int size)
  */
 void MP1Node::nodeStart(char *servaddrstr, short servport)
 {
+    MemScope scope(memory.counter(MEM_HEAP));
     Address joinaddr;
     joinaddr = getJoinAddress();
 
@@ -97,6 +160,28 @@ void MP1Node::nodeStart(char *servaddrstr, short servport)
     return;
 }
 
+/**
+ * FUNCTION NAME: restartNode
+ *
+ * DESCRIPTION: Bring a crashed node back as a fresh process under the same address:
+ * 				everything it knew is forgotten before it joins again, under the next
+ * 				incarnation, which the tombstones of its previous one don't block
+ */
+void MP1Node::restartNode(char *servaddrstr, short servport)
+{
+    MemScope scope(memory.counter(MEM_HEAP));
+    finishUpThisNode();
+    deadNodes.clear();
+    deadTimes.clear();
+    deadIncarnations.clear();
+    reportedNodes.clear();
+    newSuspects.clear();
+    incarnation++;
+    joinAttempts = 0;
+    nextJoinAt = 0;
+    nodeStart(servaddrstr, servport);
+}
+
 /**
  * FUNCTION NAME: initThisNode
  *
@@ -116,9 +201,10 @@ int MP1Node::initThisNode(Address *joinaddr)
     // node is up!
     memberNode->nnb = 0;
     memberNode->heartbeat = 0;
-    memberNode->pingCounter = TFAIL;
+    memberNode->pingCounter = par->TFAIL;
     memberNode->timeOutCounter = -1;
     initMemberListTable(memberNode);
+    publishView();
 
     return 0;
 }
@@ -130,9 +216,8 @@ int MP1Node::initThisNode(Address *joinaddr)
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr)
 {
-    MessageHdr *msg;
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if (0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr)))
@@ -145,28 +230,86 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr)
     }
     else
     {
-        size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
-        msg = (MessageHdr *)malloc(msgsize * sizeof(char));
-
-        // create JOINREQ message: format of data is {struct Address myaddr}
-        msg->msgType = JOINREQ;
-        memcpy((char *)(msg + 1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-        memcpy((char *)(msg + 1) + sizeof(memberNode->addr.addr) + 1, &memberNode->heartbeat, sizeof(long));
-
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
         log->LOG(&memberNode->addr, s);
 #endif
 
         // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        joinAttempts = 0;
+        nextJoinAt = par->getcurrtime() + par->JOIN_RETRY;
+        this->sendJoinReq(joinaddr);
     }
 
     return 1;
 }
 
+/**
+ * FUNCTION NAME: sendJoinReq
+ *
+ * DESCRIPTION: Send a JOINREQ to an introducer
+ */
+void MP1Node::sendJoinReq(Address *joinaddr)
+{
+    size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
+    MessageHdr *msg = (MessageHdr *)malloc(msgsize * sizeof(char));
+
+    // create JOINREQ message: format of data is {struct Address myaddr, unsigned char incarnation, long heartbeat}
+    msg->msgType = JOINREQ;
+    memcpy((char *)(msg + 1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
+    *((char *)(msg + 1) + sizeof(memberNode->addr.addr)) = (char)incarnation;
+    memcpy((char *)(msg + 1) + sizeof(memberNode->addr.addr) + 1, &memberNode->heartbeat, sizeof(long));
+    this->send(joinaddr, (char *)msg, msgsize);
+    free(msg);
+}
+
+/**
+ * FUNCTION NAME: retryJoin
+ *
+ * DESCRIPTION: While no JOINREP came back, ask the next introducer, waiting twice
+ * 				as long each time up to JOIN_RETRY_MAX, with some jitter so that
+ * 				joiners that failed together don't retry together
+ */
+void MP1Node::retryJoin()
+{
+    long now = par->getcurrtime();
+    if (now < nextJoinAt)
+    {
+        return;
+    }
+    joinAttempts++;
+    Address joinaddr = getJoinAddress();
+    long backoff = min((long)par->JOIN_RETRY << min(joinAttempts, 16), (long)par->JOIN_RETRY_MAX);
+    nextJoinAt = now + backoff + this->nextrand() % par->JOIN_RETRY;
+#ifdef DEBUGLOG
+    log->LOG(&memberNode->addr, "Retrying join...");
+#endif
+    this->sendJoinReq(&joinaddr);
+}
+
+/**
+ * FUNCTION NAME: answerJoins
+ *
+ * DESCRIPTION: Answer all the joins taken from the inbox with one serialized JOINREP,
+ * 				which lists every one of the joiners too. send streams it in slices
+ * 				when the group is too large for one message, so a joiner, or a
+ * 				restarted node, gets the whole view at once.
+ */
+void MP1Node::answerJoins()
+{
+    if (pendingJoins.empty())
+    {
+        return;
+    }
+    auto reply = this->serializeMSG(JOINREP);
+    for (unsigned int i = 0; i < pendingJoins.size(); i++)
+    {
+        this->send(&pendingJoins[i], reply.second, reply.first);
+    }
+    free(reply.second);
+    pendingJoins.clear();
+}
+
 /**
  * FUNCTION NAME: finishUpThisNode
  *
@@ -181,9 +324,21 @@ int MP1Node::finishUpThisNode()
     memberNode->inGroup = false;
     memberNode->nnb = 0;
     memberNode->heartbeat = 0;
-    memberNode->pingCounter = TFAIL;
+    memberNode->pingCounter = par->TFAIL;
     memberNode->timeOutCounter = -1;
     memberNode->memberList.clear();
+    passiveView.clear();
+    updates.clear();
+    pendingJoins.clear();
+    suspects.clear();
+    ring.clear();
+    while (!memberNode->mp1q.empty())
+    {
+        memory.counter(MEM_INBOX)->remove(memberNode->mp1q.front().size);
+        EmulNet::ENfree((char *)memberNode->mp1q.front().elt);
+        memberNode->mp1q.pop();
+    }
+    publishView();
     return 0;
 }
 
@@ -199,6 +354,7 @@ void MP1Node::nodeLoop()
     {
         return;
     }
+    MemScope scope(memory.counter(MEM_HEAP));
 
     // Check my messages
     checkMessages();
@@ -206,6 +362,7 @@ void MP1Node::nodeLoop()
     // Wait until you're in the group...
     if (!memberNode->inGroup)
     {
+        this->retryJoin();
         return;
     }
 
@@ -222,20 +379,32 @@ void MP1Node::nodeLoop()
  */
 void MP1Node::checkMessages()
 {
-    void *ptr;
-    int size;
+    PHASE_TIMER(PHASE_CHECK_MESSAGES);
+    MemScope scope(memory.counter(MEM_HEAP));
+    unsigned int i, n;
 
-    // Pop waiting messages from memberNode's mp1q
-    while (!memberNode->mp1q.empty())
+    // Take everything waiting in memberNode's mp1q at once, then handle it
+    if (inboxBatch.size() < memberNode->mp1q.size())
     {
-        ptr = memberNode->mp1q.front().elt;
-        size = memberNode->mp1q.front().size;
-        memberNode->mp1q.pop();
-        recvCallBack((void *)memberNode, (char *)ptr, size);
+        inboxBatch.resize(memberNode->mp1q.capacity());
+    }
+    n = memberNode->mp1q.drain(inboxBatch.data(), inboxBatch.size());
+    for (i = 0; i < n; i++)
+    {
+        recvCallBack((void *)memberNode, (char *)inboxBatch[i].elt, inboxBatch[i].size);
+        memory.counter(MEM_INBOX)->remove(inboxBatch[i].size);
+        EmulNet::ENfree((char *)inboxBatch[i].elt);
     }
+    this->answerJoins();
+    this->publishView();
     return;
 }
 
+bool mleLess(const MemberListEntry &a, const MemberListEntry &b)
+{
+    return memberKey(a.id, a.port) < memberKey(b.id, b.port);
+}
+
 Address mleAddress(MemberListEntry *mle)
 {
     Address a;
@@ -244,51 +413,153 @@ Address mleAddress(MemberListEntry *mle)
     return a;
 }
 
-void MP1Node::onJoinReq(Address *src_addr, void *data, size_t size)
+void MP1Node::onJoinReq(Address *src_addr, const JoinReqView &msg)
+{
+    // a node still joining has no group to let anyone into; the joiner will retry elsewhere
+    if (!memberNode->inGroup)
+    {
+        return;
+    }
+    long heartbeat = msg.heartbeat();
+    if (this->updateMemberList(src_addr, heartbeat, msg.incarnation()))
+    {
+        MemberListEntry joined(*(int *)src_addr->addr, *(short *)&src_addr->addr[4], heartbeat, par->getcurrtime(), msg.incarnation());
+        this->disseminate(UPDATE_JOIN, joined);
+    }
+    for (unsigned int i = 0; i < pendingJoins.size(); i++)
+    {
+        if (pendingJoins[i] == *src_addr)
+        {
+            return;
+        }
+    }
+    // answered in answerJoins, together with the other joins of this drain
+    pendingJoins.push_back(*src_addr);
+}
+
+/**
+ * FUNCTION NAME: onJoinRep
+ *
+ * DESCRIPTION: We are in the group: take the introducer's member list. With
+ * 				partial views the members it names become known through our join,
+ * 				wherever they end up.
+ */
+void MP1Node::onJoinRep(Address *src_addr, const EntryListView &msg)
+{
+    memberNode->inGroup = true;
+    this->onPing(src_addr, msg);
+    for (EntryListView::const_iterator e = msg.begin(); e != msg.end() && par->PARTIAL_VIEW; ++e)
+    {
+        MemberListEntry mle = *e;
+        MemberKey key = memberKey(mle.id, mle.port);
+        if (key != memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4])
+            && !this->isDead(key, mle.incarnation))
+        {
+            this->reportJoined(mle.id, mle.port, mle.heartbeat);
+        }
+    }
+}
+
+void MP1Node::onPing(Address *src_addr, const EntryListView &msg)
 {
-    long heartbeat = *(long *)data;
-    this->updateMemberList(src_addr, heartbeat);
-    MsgTypes msg = JOINREP;
-    auto serailizedMsg = this->serializeMSG(msg);
-    int replySize = serailizedMsg.first;
-    char *replyData = serailizedMsg.second;
+    if (par->PARTIAL_VIEW)
+    {
+        this->mergePartialView(src_addr, msg);
+    }
+    else
+    {
+        this->mergeMemberList(msg);
+    }
+}
 
-    // stringstream ss;
-    // ss << "Sending JOINREP To " << src_addr->getAddress() << " with heartbeat: " << memberNode->heartbeat;
-    // log->LOG(&memberNode->addr, ss.str().c_str());
-    emulNet->ENsend(&memberNode->addr, src_addr, replyData, replySize);
-    free(replyData);
+/**
+ * FUNCTION NAME: onIsAlive
+ *
+ * DESCRIPTION: Answer a probe with our member list
+ */
+void MP1Node::onIsAlive(Address *src_addr, const EmptyView &msg)
+{
+    auto replyData = this->serializeMSG(MsgTypes::PING);
+    this->send(src_addr, replyData.second, replyData.first);
+    free(replyData.second);
 }
 
-void MP1Node::onPing(Address *src_addr, void *data, size_t size)
+/**
+ * FUNCTION NAME: mergeMemberList
+ *
+ * DESCRIPTION: Apply an incoming membership list in one linear pass over the
+ * 				incoming list, the local table and the tombstones, all sorted by
+ * 				member key: known members take the newer incarnation and heartbeat,
+ * 				unknown ones are added unless a tombstone buries their incarnation.
+ * 				The entries are read in place; only a list out of key order is
+ * 				copied, to be sorted.
+ */
+void MP1Node::mergeMemberList(const EntryListView &list)
 {
-    vector<MemberListEntry> newData = this->deserializePing((char *)data);
+    PHASE_TIMER(PHASE_MERGE);
+    MemberTable &members = memberNode->memberList;
+    int m = members.size();
+    int i = 0, k = 0;
+    long now = par->getcurrtime();
 
-    for (int i = 0; i < newData.size(); i++)
+    const MemberListEntry *incoming = NULL;
+    int count = list.size();
+    if (!list.sorted())
     {
-        Address addr = mleAddress(&newData[i]);
-        auto it = this->susTracker.find(addr);
-        if (it != this->susTracker.end())
+        unsortedScratch.assign(list.begin(), list.end());
+        sort(unsortedScratch.begin(), unsortedScratch.end(), mleLess);
+        incoming = unsortedScratch.data();
+    }
+
+    newMembers.clear();
+    for (int j = 0; j < count; j++)
+    {
+        MemberListEntry in = incoming != NULL ? incoming[j] : list[j];
+        MemberKey key = memberKey(in.id, in.port);
+        while (i < m && members.key(i) < key)
+        {
+            i++;
+        }
+        if (i < m && members.key(i) == key)
         {
-            for (int j = 0; j < this->susTracker[addr].size(); j++)
+            if (newerState(in.incarnation, in.heartbeat, members.incarnation(i), members.heartbeat(i)))
             {
-                auto replyData = this->serializeMSG(MsgTypes::PING);
-                this->emulNet->ENsend(&memberNode->addr, &this->susTracker[addr][j], replyData.second, replyData.first);
+                if (in.incarnation != members.incarnation(i))
+                {
+                    members.setincarnation(i, in.incarnation);
+                }
+                members.setheartbeat(i, in.heartbeat);
+                members.settimestamp(i, now);
             }
-            this->susTracker[addr].clear();
-            this->susTracker.erase(it);
+            continue;
+        }
+        while (k < (int)deadNodes.size() && deadNodes[k] < key)
+        {
+            k++;
+        }
+        if (k < (int)deadNodes.size() && deadNodes[k] == key && !newerIncarnation(in.incarnation, deadIncarnations[k]))
+        {
+            continue;
+        }
+        if (!newMembers.empty() && memberKey(newMembers.back().id, newMembers.back().port) == key)
+        {
+            continue;
         }
-        this->updateMemberList(&addr, newData[i].heartbeat);
+        newMembers.push_back(MemberListEntry(in.id, in.port, in.heartbeat, now, in.incarnation));
+    }
+    members.merge(newMembers);
+    for (unsigned int j = 0; j < newMembers.size(); j++)
+    {
+        this->emitEvent(EVENT_JOINED, newMembers[j].id, newMembers[j].port, newMembers[j].heartbeat);
     }
 }
 
 void MP1Node::logMemberList()
 {
     stringstream ss;
-    for (vector<MemberListEntry>::iterator it = memberNode->memberList.begin(); it != memberNode->memberList.end(); it++)
+    for (int i = 0; i < memberNode->memberList.size(); i++)
     {
-        ss << it->getid() << ": " << it->getheartbeat() << it->gettimestamp();
-        " ), ";
+        ss << memberNode->memberList.id(i) << ": " << memberNode->memberList.heartbeat(i) << " " << memberNode->memberList.timestamp(i) << " ), ";
     }
     log->LOG(&memberNode->addr, ss.str().c_str());
 }
@@ -305,8 +576,22 @@ void MP1Node::serializeVector(char *buffer, vector<MemberListEntry> &src)
     }
 }
 
+void MP1Node::serializeTable(char *buffer, MemberTable &src)
+{
+    int n = src.size();
+    memcpy(buffer, &n, sizeof(int));
+    buffer += sizeof(int);
+    for (int i = 0; i < n; i++)
+    {
+        MemberListEntry mle = src.entry(i);
+        memcpy(buffer, &mle, sizeof(MemberListEntry));
+        buffer += sizeof(MemberListEntry);
+    }
+}
+
 pair<int, char *> MP1Node::serializeMSG(MsgTypes msgType)
 {
+    PHASE_TIMER(PHASE_SERIALIZE);
     char *msg;
     int headerSize = sizeof(MessageHdr) + sizeof(Address);
     int totalsize;
@@ -315,6 +600,11 @@ pair<int, char *> MP1Node::serializeMSG(MsgTypes msgType)
     switch (msgType)
     {
     case JOINREQ:
+    case SUS:
+    case DIS:
+    case DELTA:
+    case SHUFFLE:
+    case SHUFFLEREP:
         assert(false);
         break;
     case JOINREP:
@@ -323,24 +613,20 @@ pair<int, char *> MP1Node::serializeMSG(MsgTypes msgType)
         sizeOfVector = n * sizeof(MemberListEntry);
         totalsize = headerSize + sizeof(int) + sizeOfVector;
         msg = (char *)malloc(totalsize * sizeof(char));
-        this->serializeVector(msg + headerSize, this->memberNode->memberList);
+        this->serializeTable(msg + headerSize, this->memberNode->memberList);
         break;
-    case SUS:
-        n = this->mySusList.size();
-        sizeOfVector = n * sizeof(MemberListEntry);
-        totalsize = headerSize + sizeof(int) + sizeOfVector;
+    case DIGEST:
+        n = par->DIGEST_RANGES;
+        totalsize = headerSize + sizeof(int) + n * sizeof(unsigned long long);
         msg = (char *)malloc(totalsize * sizeof(char));
-        this->serializeVector(msg + headerSize, this->mySusList);
+        memcpy(msg + headerSize, &n, sizeof(int));
+        memcpy(msg + headerSize + sizeof(int), this->digest().data(), n * sizeof(unsigned long long));
         break;
     case ISALIVE:
+    case DISCONNECT:
         totalsize = headerSize;
         msg = (char *)malloc(totalsize * sizeof(char));
         break;
-    case DIS:
-        totalsize = headerSize + sizeof(MemberListEntry);
-        msg = (char *)malloc(totalsize * sizeof(char));
-        memcpy(msg+headerSize, &memberNode->memberList.back(), sizeof(MemberListEntry));
-        break;
     }
 
     char *starting = msg;
@@ -352,26 +638,14 @@ pair<int, char *> MP1Node::serializeMSG(MsgTypes msgType)
     return make_pair(totalsize, starting);
 }
 
-vector<MemberListEntry> MP1Node::deserializePing(char *data)
-{
-    int size;
-    memcpy(&size, data, sizeof(int));
-    data += sizeof(int);
-    vector<MemberListEntry> newData(size);
-    for (int i = 0; i < size; i++)
-    {
-        memcpy(&newData[i], data, sizeof(MemberListEntry));
-        data += sizeof(MemberListEntry);
-    }
-    return newData;
-}
-
 void MP1Node::sendMessageToKRand(MsgTypes msg)
 {
     // send random heartbeat
     // send random heartbeat to few k members
     // randomly chosen by k
-    int randNum = 50;
+    // an active view is small enough to reach all of it
+    int randNum = par->PARTIAL_VIEW ? 100 : 50;
+    MemberKey self = memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]);
     auto replyData = this->serializeMSG(msg);
 
     int replySize = replyData.first;
@@ -379,11 +653,15 @@ void MP1Node::sendMessageToKRand(MsgTypes msg)
 
     for (int i = 0; i < memberNode->memberList.size(); ++i)
     {
-        int k = rand() % 100;
-        Address dst_addr = mleAddress(&memberNode->memberList[i]);
+        if (par->PARTIAL_VIEW && memberNode->memberList.key(i) == self)
+        {
+            continue;
+        }
+        int k = this->nextrand() % 100;
+        Address dst_addr = memberNode->memberList.address(i);
         if (k < randNum)
         {
-            emulNet->ENsend(&memberNode->addr, &dst_addr, serilizedData, replySize);
+            this->send(&dst_addr, serilizedData, replySize);
         }
         else
         {
@@ -393,210 +671,1556 @@ void MP1Node::sendMessageToKRand(MsgTypes msg)
     free(serilizedData);
 }
 
-bool MP1Node::updateMemberList(Address *addr, long heartbeat)
+bool MP1Node::updateMemberList(Address *addr, long heartbeat, unsigned char incarnation)
 {
-    for (vector<MemberListEntry>::iterator it = memberNode->memberList.begin(); it != memberNode->memberList.end(); it++)
+    PHASE_TIMER(PHASE_MERGE);
+    int i = memberNode->memberList.find(*((int *)addr->addr), *((short *)&(addr->addr[4])));
+    if (i >= 0)
     {
-        if (mleAddress(&(*it)) == *addr)
+        if (newerState(incarnation, heartbeat, memberNode->memberList.incarnation(i), memberNode->memberList.heartbeat(i)))
         {
-            if (heartbeat > it->getheartbeat())
-            {
-                it->setheartbeat(heartbeat);
-                it->settimestamp(par->getcurrtime());
-                return true;
-            }
-            else
+            if (incarnation != memberNode->memberList.incarnation(i))
             {
-                return false;
+                memberNode->memberList.setincarnation(i, incarnation);
             }
+            memberNode->memberList.setheartbeat(i, heartbeat);
+            memberNode->memberList.settimestamp(i, par->getcurrtime());
+            return true;
+        }
+        else
+        {
+            return false;
         }
     }
-    if (this->deadNodes.find(*addr) != this->deadNodes.end()) {
+    if (this->isDead(memberKey(*((int *)addr->addr), *((short *)&(addr->addr[4]))), incarnation)) {
         return false;
     }
-    MemberListEntry mle(*((int *)addr->addr), *((short *)&(addr->addr[4])), heartbeat, par->getcurrtime());
-    memberNode->memberList.push_back(mle);
-    // log->logNodeAdd(&memberNode->addr, addr);
+    MemberListEntry mle(*((int *)addr->addr), *((short *)&(addr->addr[4])), heartbeat, par->getcurrtime(), incarnation);
+    if (par->PARTIAL_VIEW)
+    {
+        // a joining node is always let into the active view
+        if (!this->addToActive(mle, true))
+        {
+            return false;
+        }
+        this->reportJoined(mle.id, mle.port, mle.heartbeat);
+        return true;
+    }
+    memberNode->memberList.insert(mle);
+    this->emitEvent(EVENT_JOINED, mle.id, mle.port, mle.heartbeat);
     return true;
 }
 
-void MP1Node::onSus(Address *src_addr, void *data, size_t size)
-{
-    vector<MemberListEntry> incomingSusList = this->deserializePing((char *)data);
-    for (int i = 0; i < incomingSusList.size(); i++)
+/**
+ * FUNCTION NAME: removeNode
+ *
+ * DESCRIPTION: A DIS message names a removed member: apply it as a dead update,
+ * 				which is then spread by piggybacking rather than re-broadcast.
+ * 				With RECONNECT_PERIOD set, a DIS naming ourselves is answered
+ * 				with a PING once applyUpdate refuted it.
+ */
+void MP1Node::removeNode(Address *src_addr, const DisView &msg) {
+    const MemberListEntry &node = msg.entry();
+
+    MemberUpdate u;
+    memset(&u, 0, sizeof(MemberUpdate));
+    u.id = node.id;
+    u.port = node.port;
+    u.type = UPDATE_DEAD;
+    u.incarnation = node.incarnation;
+    u.heartbeat = node.heartbeat;
+    this->applyUpdate(u);
+    if (par->RECONNECT_PERIOD > 0 && memberKey(node.id, node.port) == memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]))
     {
-        Address sus_addr = mleAddress(&incomingSusList[i]);
-        auto dummyMsg = this->serializeMSG(MsgTypes::ISALIVE);
-        this->susTracker[sus_addr].push_back(*src_addr);
-        emulNet->ENsend(&memberNode->addr, &sus_addr, dummyMsg.second, dummyMsg.first);
+        // we were buried while running: show the sender our new incarnation
+        auto reply = this->serializeMSG(MsgTypes::PING);
+        this->send(src_addr, reply.second, reply.first);
+        free(reply.second);
     }
 }
 
-void MP1Node::removeNode(Address* src_addr, void* data, size_t size) {
-    MemberListEntry node;
-    memcpy(&node, data, sizeof(MemberListEntry));
-    Address addr = mleAddress(&node);
-
-    // cout << memberNode->memberList.size() << "IN REMOVE NODE" << endl;
-    for (int i = 0; i < memberNode->memberList.size(); i++) {
-        if (memberNode->memberList[i].id == node.id && memberNode->memberList[i].port == node.port) {
-            swap(memberNode->memberList[i], memberNode->memberList.back());
-            this->sendMessageToKRand(MsgTypes::DIS);
-            memberNode->memberList.pop_back();
-            this->deadNodes.insert(addr);
-            // log->logNodeRemove(&memberNode->addr, &addr);
-            log->LOG(&memberNode->addr, "removed because of DIS msg");
-            break;
-        }
-    }
+/**
+ * FUNCTION NAME: digestMix
+ *
+ * DESCRIPTION: 32-bit hash of one member as seen in a digest: its key and heartbeat bucket
+ */
+static unsigned long long digestMix(MemberKey key, long bucket)
+{
+    unsigned long long x = (unsigned long long)key * 0x9e3779b97f4a7c15ULL ^ (unsigned long long)bucket;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (x ^ (x >> 31)) >> 32;
 }
 
 /**
- * FUNCTION NAME: recvCallBack
+ * FUNCTION NAME: digest
  *
- * DESCRIPTION: Message handler for different message types
+ * DESCRIPTION: Summary of the member list for anti-entropy. Members fall into
+ * 				DIGEST_RANGES ranges by id; each range packs, in the high 32 bits,
+ * 				the sum of its members' digestMix and, in the low 32 bits, the sum
+ * 				of their heartbeat buckets. A member's incarnation counts far above
+ * 				its heartbeat bucket, so a view holding a restarted member's new
+ * 				incarnation is ahead of one holding its old process. Two views agree
+ * 				on a range when the hashes match, and the larger bucket sum tells
+ * 				which one is ahead.
+ * 				Recomputed only after the member list changed.
  */
-bool MP1Node::recvCallBack(void *env, char *data, int size)
+vector<unsigned long long> &MP1Node::digest()
 {
-    /*
-     * Your code goes here
-     */
-    MessageHdr *msg = (MessageHdr *)data;
-    Address *src_addr = (Address *)(msg + 1);
-    size -= sizeof(MessageHdr) + sizeof(Address);
-    data += sizeof(MessageHdr) + sizeof(Address);
-    if (msg->msgType == JOINREQ)
+    MemberTable &members = memberNode->memberList;
+    if (digestVersion == members.changes() && (int)myDigest.size() == par->DIGEST_RANGES)
     {
-        this->onJoinReq(src_addr, data, size);
+        return myDigest;
     }
-    else if (msg->msgType == PING)
+    myDigest.assign(par->DIGEST_RANGES, 0);
+    for (int i = 0; i < members.size(); i++)
     {
-        this->onPing(src_addr, data, size);
+        long bucket = members.heartbeat(i) / par->DIGEST_BUCKET + ((long)members.incarnation(i) << 20);
+        myDigest[(unsigned int)members.id(i) % par->DIGEST_RANGES] += (digestMix(members.key(i), bucket) << 32) + (unsigned int)bucket;
     }
-    else if (msg->msgType == SUS)
+    digestVersion = members.changes();
+    return myDigest;
+}
+
+/**
+ * FUNCTION NAME: onDigest
+ *
+ * DESCRIPTION: Compare a peer's digest with ours range by range. Ranges where we
+ * 				are ahead are pushed to the peer, ranges where it is ahead are
+ * 				pulled from it, unless another peer was already asked for them
+ * 				this tick. Agreeing views exchange nothing more. Heartbeat buckets
+ * 				drift apart between peers, so even in a steady group most ranges
+ * 				differ: the deltas are what carries heartbeats between nodes.
+ */
+void MP1Node::onDigest(Address *src_addr, const DigestView &msg)
+{
+    vector<unsigned long long> &mine = this->digest();
+    unsigned long long push = 0, want = 0;
+    int now = par->getcurrtime();
+    int n = msg.size();
+
+    if (digestWanted.size() != mine.size())
     {
-        this->onSus(src_addr, data, size);
+        digestWanted.assign(mine.size(), -1);
     }
-    else if (msg->msgType == ISALIVE)
+    if (n != (int)mine.size())
     {
-        auto replyData = this->serializeMSG(MsgTypes::PING);
-        this->emulNet->ENsend(&memberNode->addr, src_addr, replyData.second, replyData.first);
+        // Digests of different shapes can't be compared, exchange every range
+        push = want = mine.size() >= 64 ? ~0ULL : (1ULL << mine.size()) - 1;
     }
-    else  if (msg->msgType == DIS) {
-        this->removeNode(src_addr, data, size);
+    else
+    {
+        for (int r = 0; r < n; r++)
+        {
+            unsigned long long other = msg[r];
+            if (other == mine[r])
+            {
+                continue;
+            }
+            int ahead = (int)((unsigned int)mine[r] - (unsigned int)other);
+            if (ahead >= 0)
+            {
+                push |= 1ULL << r;
+            }
+            if (ahead <= 0 && digestWanted[r] != now)
+            {
+                want |= 1ULL << r;
+                digestWanted[r] = now;
+            }
+        }
     }
-    else if (msg->msgType == JOINREP)
+    if (push != 0 || want != 0)
     {
-        memberNode->inGroup = true;
-        this->onPing(src_addr, data, size);
+        this->sendDelta(src_addr, push, want);
     }
-    else
+}
+
+/**
+ * FUNCTION NAME: onDelta
+ *
+ * DESCRIPTION: Merge the members a peer sent for the ranges our digests disagree
+ * 				on, and send ours back for the ranges it asked for
+ */
+void MP1Node::onDelta(Address *src_addr, const DeltaView &msg)
+{
+    this->onPing(src_addr, msg.entries());
+    if (msg.want() != 0)
     {
-        log->LOG(&memberNode->addr, "NOT JOINREQ OR JOINREP");
-        return false;
+        this->sendDelta(src_addr, msg.want(), 0);
     }
-    free(msg);
-    return true;
 }
 
 /**
- * FUNCTION NAME: nodeLoopOps
+ * FUNCTION NAME: sendDelta
  *
- * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
- * 				the nodes
- * 				Propagate your membership list
+ * DESCRIPTION: Send our members whose id range is set in ranges, asking for the
+ * 				peer's members in the ranges set in want.
+ * 				Format: {want, int n, n MemberListEntry}
  */
-void MP1Node::nodeLoopOps()
+void MP1Node::sendDelta(Address *dst_addr, unsigned long long ranges, unsigned long long want)
 {
+    MemberTable &members = memberNode->memberList;
+    int headerSize = sizeof(MessageHdr) + sizeof(Address);
+    int count = 0;
 
-    /*
-     * Your code goes here
-     */
-    // if (par->getcurrtime() == 490) {
-    //     this->logMemberList();
-    // }
-    int timeout = TREMOVE;
-    stringstream ss;
-    for (int i = 0; i < memberNode->memberList.size(); i++)
+    for (int i = 0; i < members.size(); i++)
     {
-        MemberListEntry node = memberNode->memberList[i];
-        if (par->getcurrtime() - node.timestamp > timeout)
+        if ((ranges >> ((unsigned int)members.id(i) % par->DIGEST_RANGES)) & 1)
         {
-            this->mySusList.push_back(node);
+            count++;
         }
+    }
+    int totalsize = headerSize + sizeof(unsigned long long) + sizeof(int) + count * sizeof(MemberListEntry);
+    char *msg = (char *)malloc(totalsize * sizeof(char));
+    char *p = msg;
 
-        if (par->getcurrtime() - node.timestamp - TFAIL > timeout)
+    MessageHdr hdr;
+    hdr.msgType = DELTA;
+    memcpy(p, &hdr, sizeof(MessageHdr));
+    p += sizeof(MessageHdr);
+    memcpy(p, &memberNode->addr, sizeof(Address));
+    p += sizeof(Address);
+    memcpy(p, &want, sizeof(unsigned long long));
+    p += sizeof(unsigned long long);
+    memcpy(p, &count, sizeof(int));
+    p += sizeof(int);
+    for (int i = 0; i < members.size(); i++)
+    {
+        if ((ranges >> ((unsigned int)members.id(i) % par->DIGEST_RANGES)) & 1)
         {
-            Address addr = mleAddress(&node);
-            swap(memberNode->memberList[i], memberNode->memberList[memberNode->memberList.size()-1]);
-            this->sendMessageToKRand(MsgTypes::DIS);
-            this->deadNodes.insert(addr);
-            memberNode->memberList.pop_back();
-            i--;
-            // this->logMemberList();
-
-            log->logNodeRemove(&memberNode->addr, &addr);
+            MemberListEntry mle = members.entry(i);
+            memcpy(p, &mle, sizeof(MemberListEntry));
+            p += sizeof(MemberListEntry);
         }
     }
-    if (this->mySusList.size() > 0)
-    {
-        this->sendMessageToKRand(MsgTypes::SUS);
-        this->mySusList.clear();
-    }
 
-    memberNode->heartbeat++;
-    if (memberNode->heartbeat % 3 == 0)
-    {
-        this->updateMemberList(&memberNode->addr, memberNode->heartbeat);
-        this->sendMessageToKRand(MsgTypes::PING);
-    }
-    return;
+    this->send(dst_addr, msg, totalsize);
+    free(msg);
 }
 
 /**
- * FUNCTION NAME: isNullAddress
+ * FUNCTION NAME: activeCount
  *
- * DESCRIPTION: Function checks if the address is NULL
+ * DESCRIPTION: Peers in the active view, i.e. the member list without ourselves
  */
-int MP1Node::isNullAddress(Address *addr)
+int MP1Node::activeCount()
 {
-    return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+    return memberNode->memberList.size() - (memberNode->inited ? 1 : 0);
 }
 
 /**
- * FUNCTION NAME: getJoinAddress
+ * FUNCTION NAME: nextrand
  *
- * DESCRIPTION: Returns the Address of the coordinator
+ * DESCRIPTION: Next number of this node's random stream. Nodes draw from their own
+ * 				streams so that their protocol choices don't depend on one another.
  */
-Address MP1Node::getJoinAddress()
+int MP1Node::nextrand()
 {
-    Address joinaddr;
-
-    memset(&joinaddr, 0, sizeof(Address));
-    *(int *)(&joinaddr.addr) = 1;
-    *(short *)(&joinaddr.addr[4]) = 0;
+    return rand_r(&randState);
+}
 
-    return joinaddr;
+/**
+ * FUNCTION NAME: randomPeer
+ *
+ * DESCRIPTION: Index of a random entry of view other than except, -1 if there is none
+ */
+int MP1Node::randomPeer(MemberTable &view, MemberKey except)
+{
+    int n = view.size();
+    if (n == 0)
+    {
+        return -1;
+    }
+    int i = this->nextrand() % n;
+    if (view.key(i) == except)
+    {
+        i = n > 1 ? (i + 1) % n : -1;
+    }
+    return i;
 }
 
 /**
- * FUNCTION NAME: initMemberListTable
+ * FUNCTION NAME: addToActive
  *
- * DESCRIPTION: Initialize the membership list
+ * DESCRIPTION: Partial view mode: start monitoring a peer. When the active view
+ * 				is full the peer is refused, unless force is set, in which case a
+ * 				random active peer is moved to the passive view and told so.
+ * 				Moving a peer between views is no membership event.
+ *
+ * RETURNS:
+ * whether the peer is in the active view
  */
-void MP1Node::initMemberListTable(Member *memberNode)
+bool MP1Node::addToActive(const MemberListEntry &mle, bool force)
 {
-    memberNode->memberList.clear();
-    int id = *(int *)(&memberNode->addr.addr);
-    short port = *(short *)(&memberNode->addr.addr[4]);
+    MemberTable &active = memberNode->memberList;
+    MemberKey self = memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]);
+    MemberKey key = memberKey(mle.id, mle.port);
 
-    MemberListEntry mle(id, port);
-    mle.settimestamp(par->getcurrtime());
+    if (key == self || this->isDead(key, mle.incarnation))
+    {
+        return false;
+    }
+    if (active.find(mle.id, mle.port) >= 0)
+    {
+        return true;
+    }
+    if (this->activeCount() >= par->ACTIVE_VIEW)
+    {
+        if (!force)
+        {
+            return false;
+        }
+        int v = this->randomPeer(active, self);
+        MemberListEntry evicted = active.entry(v);
+        Address evictedAddr = active.address(v);
+        active.remove(v);
+        this->addToPassive(evicted);
+        auto msg = this->serializeMSG(MsgTypes::DISCONNECT);
+        this->send(&evictedAddr, msg.second, msg.first);
+        free(msg.second);
+    }
+    int p = passiveView.find(mle.id, mle.port);
+    if (p >= 0)
+    {
+        passiveView.remove(p);
+    }
+    active.insert(MemberListEntry(mle.id, mle.port, mle.heartbeat, par->getcurrtime(), mle.incarnation));
+    return true;
+}
+
+/**
+ * FUNCTION NAME: addToPassive
+ *
+ * DESCRIPTION: Partial view mode: remember a peer without monitoring it,
+ * 				replacing a random passive entry when the passive view is full.
+ * 				Neither is a membership event: passive views turn over all the
+ * 				time, the replaced entry is likely alive and the new one may have
+ * 				been known before.
+ */
+void MP1Node::addToPassive(const MemberListEntry &mle)
+{
+    MemberKey key = memberKey(mle.id, mle.port);
+    if (par->PASSIVE_VIEW <= 0 || key == memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4])
+        || this->isDead(key, mle.incarnation) || memberNode->memberList.find(mle.id, mle.port) >= 0)
+    {
+        return;
+    }
+    int p = passiveView.find(mle.id, mle.port);
+    if (p >= 0)
+    {
+        if (newerState(mle.incarnation, mle.heartbeat, passiveView.incarnation(p), passiveView.heartbeat(p)))
+        {
+            if (mle.incarnation != passiveView.incarnation(p))
+            {
+                passiveView.setincarnation(p, mle.incarnation);
+            }
+            passiveView.setheartbeat(p, mle.heartbeat);
+        }
+        return;
+    }
+    if (passiveView.size() >= par->PASSIVE_VIEW)
+    {
+        passiveView.remove(this->nextrand() % passiveView.size());
+    }
+    passiveView.insert(MemberListEntry(mle.id, mle.port, mle.heartbeat, par->getcurrtime(), mle.incarnation));
+}
+
+/**
+ * FUNCTION NAME: mergePartialView
+ *
+ * DESCRIPTION: Partial view mode counterpart of mergeMemberList: heartbeats of
+ * 				active peers are taken as usual, anyone else goes to the passive
+ * 				view. A sender we don't monitor is taken into the active view if
+ * 				there is room, and told to disconnect otherwise, so that active
+ * 				views stay symmetric.
+ */
+void MP1Node::mergePartialView(Address *src_addr, const EntryListView &incoming)
+{
+    PHASE_TIMER(PHASE_MERGE);
+    MemberTable &active = memberNode->memberList;
+    int srcId = *(int *)src_addr->addr;
+    short srcPort = *(short *)&src_addr->addr[4];
+    long now = par->getcurrtime();
+
+    if (active.find(srcId, srcPort) < 0)
+    {
+        MemberListEntry src(srcId, srcPort, 0, now);
+        for (EntryListView::const_iterator e = incoming.begin(); e != incoming.end(); ++e)
+        {
+            MemberListEntry mle = *e;
+            if (mle.id == srcId && mle.port == srcPort)
+            {
+                src.heartbeat = mle.heartbeat;
+                src.incarnation = mle.incarnation;
+            }
+        }
+        if (!this->isDead(memberKey(srcId, srcPort), src.incarnation) && !this->addToActive(src, false))
+        {
+            auto msg = this->serializeMSG(MsgTypes::DISCONNECT);
+            this->send(src_addr, msg.second, msg.first);
+            free(msg.second);
+        }
+    }
+
+    for (EntryListView::const_iterator e = incoming.begin(); e != incoming.end(); ++e)
+    {
+        MemberListEntry mle = *e;
+        // only we can tell our own heartbeat
+        if (mle.id == *(int *)memberNode->addr.addr && mle.port == *(short *)&memberNode->addr.addr[4])
+        {
+            continue;
+        }
+        int i = active.find(mle.id, mle.port);
+        if (i >= 0)
+        {
+            if (newerState(mle.incarnation, mle.heartbeat, active.incarnation(i), active.heartbeat(i)))
+            {
+                if (mle.incarnation != active.incarnation(i))
+                {
+                    active.setincarnation(i, mle.incarnation);
+                }
+                active.setheartbeat(i, mle.heartbeat);
+                active.settimestamp(i, now);
+            }
+        }
+        else
+        {
+            this->addToPassive(mle);
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: fillActiveView
+ *
+ * DESCRIPTION: Partial view mode: while the active view is short, promote one
+ * 				random passive peer per round and ping it so it links back
+ */
+void MP1Node::fillActiveView()
+{
+    if (this->activeCount() >= par->ACTIVE_VIEW || passiveView.empty())
+    {
+        return;
+    }
+    int p = this->nextrand() % passiveView.size();
+    MemberListEntry mle = passiveView.entry(p);
+    Address addr = passiveView.address(p);
+    if (this->addToActive(mle, false))
+    {
+        auto msg = this->serializeMSG(MsgTypes::PING);
+        this->send(&addr, msg.second, msg.first);
+        free(msg.second);
+    }
+}
+
+/**
+ * FUNCTION NAME: sendEntries
+ *
+ * DESCRIPTION: Send a list of entries in the PING list format
+ */
+void MP1Node::sendEntries(Address *dst_addr, MsgTypes msgType, vector<MemberListEntry> &entries)
+{
+    int headerSize = sizeof(MessageHdr) + sizeof(Address);
+    int totalsize = headerSize + sizeof(int) + entries.size() * sizeof(MemberListEntry);
+    char *msg = (char *)malloc(totalsize * sizeof(char));
+
+    MessageHdr hdr;
+    hdr.msgType = msgType;
+    memcpy(msg, &hdr, sizeof(MessageHdr));
+    memcpy(msg + sizeof(MessageHdr), &memberNode->addr, sizeof(Address));
+    this->serializeVector(msg + headerSize, entries);
+    this->send(dst_addr, msg, totalsize);
+    free(msg);
+}
+
+/**
+ * FUNCTION NAME: sendShuffle
+ *
+ * DESCRIPTION: Partial view mode: offer a random active peer ourselves and up to
+ * 				SHUFFLE_LENGTH random entries of our active and passive views
+ */
+void MP1Node::sendShuffle()
+{
+    MemberTable &active = memberNode->memberList;
+    MemberKey self = memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]);
+    int peer = this->randomPeer(active, self);
+    if (peer < 0)
+    {
+        return;
+    }
+    Address peerAddr = active.address(peer);
+
+    vector<MemberListEntry> pool;
+    for (int i = 0; i < active.size(); i++)
+    {
+        if (i != peer && active.key(i) != self)
+        {
+            pool.push_back(active.entry(i));
+        }
+    }
+    for (int i = 0; i < passiveView.size(); i++)
+    {
+        pool.push_back(passiveView.entry(i));
+    }
+    vector<MemberListEntry> offer;
+    int self_i = active.find(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]);
+    if (self_i >= 0)
+    {
+        offer.push_back(active.entry(self_i));
+    }
+    // partial Fisher-Yates: the first picks of pool become the sample
+    for (int k = 0; k < par->SHUFFLE_LENGTH && k < (int)pool.size(); k++)
+    {
+        int j = k + this->nextrand() % (pool.size() - k);
+        swap(pool[k], pool[j]);
+        offer.push_back(pool[k]);
+    }
+    this->sendEntries(&peerAddr, MsgTypes::SHUFFLE, offer);
+}
+
+/**
+ * FUNCTION NAME: onShuffle
+ *
+ * DESCRIPTION: Partial view mode: answer a shuffle with as many random passive
+ * 				entries as were offered, then keep the offered ones as passive
+ */
+void MP1Node::onShuffle(Address *src_addr, const EntryListView &msg)
+{
+    vector<MemberListEntry> answer;
+    vector<int> picks;
+    for (int i = 0; i < passiveView.size(); i++)
+    {
+        picks.push_back(i);
+    }
+    for (unsigned int k = 0; k < (unsigned int)msg.size() && k < picks.size(); k++)
+    {
+        int j = k + this->nextrand() % (picks.size() - k);
+        swap(picks[k], picks[j]);
+        answer.push_back(passiveView.entry(picks[k]));
+    }
+    this->sendEntries(src_addr, MsgTypes::SHUFFLEREP, answer);
+    this->onShuffleRep(src_addr, msg);
+}
+
+/**
+ * FUNCTION NAME: onShuffleRep
+ *
+ * DESCRIPTION: Partial view mode: keep the entries a shuffle peer offered as passive
+ */
+void MP1Node::onShuffleRep(Address *src_addr, const EntryListView &msg)
+{
+    for (EntryListView::const_iterator e = msg.begin(); e != msg.end(); ++e)
+    {
+        this->addToPassive(*e);
+    }
+}
+
+/**
+ * FUNCTION NAME: onDisconnect
+ *
+ * DESCRIPTION: Partial view mode: a peer dropped us from its active view, so stop
+ * 				monitoring it and keep it as passive
+ */
+void MP1Node::onDisconnect(Address *src_addr, const EmptyView &msg)
+{
+    int i = memberNode->memberList.find(*(int *)src_addr->addr, *(short *)&src_addr->addr[4]);
+    if (i >= 0)
+    {
+        MemberListEntry mle = memberNode->memberList.entry(i);
+        memberNode->memberList.remove(i);
+        this->addToPassive(mle);
+    }
+}
+
+/**
+ * FUNCTION NAME: send
+ *
+ * DESCRIPTION: Send a message built as {MessageHdr, Address, payload}. A message whose
+ * 				member list makes it too long for MAX_MSG_SIZE is streamed as
+ * 				consecutive messages of its type, each with a slice of the list and
+ * 				room for PIGGYBACK_MAX updates, or for as many as fill half of
+ * 				it when that is fewer; a DELTA's want rides on the first
+ * 				slice only. Any other message goes out whole. Slicing stops
+ * 				at the first slice the peer's inbox refuses.
+ *
+ * RETURNS:
+ * what ENsend returned for the message, or for its last slice
+ */
+int MP1Node::send(Address *dst_addr, char *msg, int size)
+{
+    int headerSize = sizeof(MessageHdr) + sizeof(Address);
+    int prefix, total, result = 0;
+    MessageHdr hdr;
+
+    memcpy(&hdr, msg, sizeof(MessageHdr));
+    switch (hdr.msgType)
+    {
+    case JOINREP:
+    case PING:
+    case SHUFFLE:
+    case SHUFFLEREP:
+        prefix = 0;
+        break;
+    case DELTA:
+        prefix = sizeof(unsigned long long);
+        break;
+    default:
+        prefix = -1;
+        break;
+    }
+    if (prefix < 0 || size + 1 + (int)sizeof(en_msg) < par->MAX_MSG_SIZE)
+    {
+        return this->transmit(dst_addr, msg, size);
+    }
+
+    int listAt = headerSize + prefix + sizeof(int);
+    memcpy(&total, msg + listAt - sizeof(int), sizeof(int));
+    total = min(total, (size - listAt) / (int)sizeof(MemberListEntry));
+    // room for PIGGYBACK_MAX updates, but never more than half the slice; transmit piggybacks
+    // no more than fits, so no slice exceeds MAX_MSG_SIZE
+    int room = par->MAX_MSG_SIZE - (int)sizeof(en_msg) - listAt - 2;
+    int reserve = min(par->PIGGYBACK_MAX * (int)sizeof(MemberUpdate), room / 2);
+    int capacity = max(1, (room - reserve) / (int)sizeof(MemberListEntry));
+
+    sliceBuffer.resize(listAt + capacity * sizeof(MemberListEntry));
+    memcpy(sliceBuffer.data(), msg, listAt);
+    for (int from = 0; from < total; from += capacity)
+    {
+        int n = min(capacity, total - from);
+        memcpy(sliceBuffer.data() + listAt - sizeof(int), &n, sizeof(int));
+        memcpy(sliceBuffer.data() + listAt, msg + listAt + from * sizeof(MemberListEntry), n * sizeof(MemberListEntry));
+        result = this->transmit(dst_addr, sliceBuffer.data(), listAt + n * sizeof(MemberListEntry));
+        if (result == EN_BACKPRESSURE)
+        {
+            break;
+        }
+        if (prefix > 0)
+        {
+            // the peer answers the want once
+            memset(sliceBuffer.data() + headerSize, 0, prefix);
+        }
+    }
+    return result;
+}
+
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Send one message built as {MessageHdr, Address, payload}, inserting after
+ * 				the address a block of piggybacked membership updates:
+ * 				{unsigned char n, n MemberUpdate}. As many updates are taken as
+ * 				PIGGYBACK_MAX and the message size limit allow.
+ * 				A peer whose inbox is full is left alone for the rest of the
+ * 				tick: the message is dropped, as on a lossy link, the gossip
+ * 				of the next rounds carrying the same state, and its piggybacked
+ * 				updates go back to the buffer.
+ *
+ * RETURNS:
+ * what ENsend returned, EN_BACKPRESSURE without sending to a peer refused this tick
+ */
+int MP1Node::transmit(Address *dst_addr, char *msg, int size)
+{
+    int headerSize = sizeof(MessageHdr) + sizeof(Address);
+    MemberKey peer = memberKey(*(int *)dst_addr->addr, *(short *)&dst_addr->addr[4]);
+    if (congestedAt != par->getcurrtime())
+    {
+        congested.clear();
+        congestedAt = par->getcurrtime();
+    }
+    else if (find(congested.begin(), congested.end(), peer) != congested.end())
+    {
+        return EN_BACKPRESSURE;
+    }
+    int room = (par->MAX_MSG_SIZE - (int)sizeof(en_msg) - size - 2) / (int)sizeof(MemberUpdate);
+
+    piggyback.resize(par->PIGGYBACK_MAX);
+    int n = updates.select(piggyback.data(), min(par->PIGGYBACK_MAX, room), this->retransmitLimit());
+    int totalsize = size + 1 + n * sizeof(MemberUpdate);
+
+    sendBuffer.resize(totalsize);
+    char *p = sendBuffer.data();
+    memcpy(p, msg, headerSize);
+    p += headerSize;
+    *p++ = (unsigned char)n;
+    memcpy(p, piggyback.data(), n * sizeof(MemberUpdate));
+    p += n * sizeof(MemberUpdate);
+    memcpy(p, msg + headerSize, size - headerSize);
+    int result = emulNet->ENsend(&memberNode->addr, dst_addr, sendBuffer.data(), totalsize);
+    if (result == EN_BACKPRESSURE)
+    {
+        updates.requeue(piggyback.data(), n, this->retransmitLimit());
+        congested.push_back(peer);
+    }
+    return result;
+}
+
+/**
+ * FUNCTION NAME: retransmitLimit
+ *
+ * DESCRIPTION: Times an update is piggybacked before it is dropped, PIGGYBACK_LAMBDA * log2(N + 1)
+ * 				for the N members we know of, enough for it to reach everyone in O(log N) rounds
+ */
+int MP1Node::retransmitLimit()
+{
+    int n = memberNode->memberList.size() + passiveView.size();
+    return (int)ceil(par->PIGGYBACK_LAMBDA * log2(n + 1.0));
+}
+
+/**
+ * FUNCTION NAME: disseminate
+ *
+ * DESCRIPTION: Queue an update about a member for piggybacking
+ */
+void MP1Node::disseminate(UpdateType type, const MemberListEntry &mle)
+{
+    MemberUpdate u;
+    memset(&u, 0, sizeof(MemberUpdate));
+    u.id = mle.id;
+    u.port = mle.port;
+    u.type = type;
+    u.incarnation = mle.incarnation;
+    u.heartbeat = mle.heartbeat;
+    updates.add(u);
+}
+
+/**
+ * FUNCTION NAME: applyUpdate
+ *
+ * DESCRIPTION: Act on a piggybacked update and pass it on if it was news to us.
+ * 				A dead member is tombstoned and removed; a joined or alive one is
+ * 				added or refreshed; a suspicion is only passed on, our own timeouts
+ * 				deciding, except that a suspicion about ourselves is refuted with
+ * 				an alive update of a higher heartbeat. With RECONNECT_PERIOD set,
+ * 				our own removal is refuted too, by moving to the next incarnation.
+ * 				Updates about an earlier incarnation than the one we know of are
+ * 				stale and dropped.
+ *
+ * RETURNS:
+ * whether the update was news
+ */
+bool MP1Node::applyUpdate(const MemberUpdate &u)
+{
+    MemberTable &members = memberNode->memberList;
+    MemberKey key = memberKey(u.id, u.port);
+    long now = par->getcurrtime();
+
+    if (key == memberKey(*(int *)memberNode->addr.addr, *(short *)&memberNode->addr.addr[4]))
+    {
+        // a suspicion of the process we replaced needs no answer
+        if (u.type == UPDATE_SUSPECT && u.incarnation == incarnation)
+        {
+            if (memberNode->heartbeat <= u.heartbeat)
+            {
+                memberNode->heartbeat = u.heartbeat + 1;
+            }
+            this->disseminate(UPDATE_ALIVE, MemberListEntry(u.id, u.port, memberNode->heartbeat, now, incarnation));
+        }
+        else if (u.type == UPDATE_DEAD && u.incarnation == incarnation && par->RECONNECT_PERIOD > 0)
+        {
+            // removed while still running, as across a partition: come back as the next incarnation,
+            // which the tombstones of this one don't block
+            incarnation++;
+            this->updateMemberList(&memberNode->addr, memberNode->heartbeat, incarnation);
+            this->disseminate(UPDATE_ALIVE, MemberListEntry(u.id, u.port, memberNode->heartbeat, now, incarnation));
+        }
+        return false;
+    }
+    if (this->isDead(key, u.incarnation))
+    {
+        return false;
+    }
+
+    int i = members.find(u.id, u.port);
+    int p = passiveView.find(u.id, u.port);
+    if ((i >= 0 && newerIncarnation(members.incarnation(i), u.incarnation))
+        || (p >= 0 && newerIncarnation(passiveView.incarnation(p), u.incarnation)))
+    {
+        return false;
+    }
+    if (u.type == UPDATE_DEAD)
+    {
+        this->addTombstone(key, u.incarnation);
+        if (i >= 0)
+        {
+            members.remove(i);
+        }
+        if (p >= 0)
+        {
+            passiveView.remove(p);
+        }
+        // with partial views the removal is news to the group even where the member was never seen
+        if (i >= 0 || par->PARTIAL_VIEW)
+        {
+            this->emitEvent(EVENT_REMOVED, u.id, u.port, u.heartbeat);
+        }
+        return updates.add(u);
+    }
+    if (u.type == UPDATE_SUSPECT)
+    {
+        if (i >= 0 && newerState(members.incarnation(i), members.heartbeat(i), u.incarnation, u.heartbeat))
+        {
+            // we heard from it since
+            return false;
+        }
+        return updates.add(u);
+    }
+    if (par->PARTIAL_VIEW)
+    {
+        // its join or alive update makes a member known, whichever view takes it
+        this->reportJoined(u.id, u.port, u.heartbeat);
+    }
+    if (i >= 0)
+    {
+        if (!newerState(u.incarnation, u.heartbeat, members.incarnation(i), members.heartbeat(i)))
+        {
+            return false;
+        }
+        if (u.incarnation != members.incarnation(i))
+        {
+            members.setincarnation(i, u.incarnation);
+        }
+        members.setheartbeat(i, u.heartbeat);
+        members.settimestamp(i, now);
+    }
+    else if (par->PARTIAL_VIEW)
+    {
+        if (p >= 0 && !newerState(u.incarnation, u.heartbeat, passiveView.incarnation(p), passiveView.heartbeat(p)))
+        {
+            return false;
+        }
+        this->addToPassive(MemberListEntry(u.id, u.port, u.heartbeat, now, u.incarnation));
+    }
+    else
+    {
+        members.insert(MemberListEntry(u.id, u.port, u.heartbeat, now, u.incarnation));
+        this->emitEvent(EVENT_JOINED, u.id, u.port, u.heartbeat);
+    }
+    return updates.add(u);
+}
+
+/**
+ * FUNCTION NAME: emitEvent
+ *
+ * DESCRIPTION: Publish a membership event: call the subscribers, queue it for
+ * 				pollEvents, counting it as lost if nobody drained the ring in
+ * 				time, and log joins and removals. With partial views, keep track of
+ * 				the members reported joined and not removed since.
+ */
+void MP1Node::emitEvent(MemberEventType type, int id, short port, long heartbeat)
+{
+    MemberEvent e;
+    e.type = type;
+    e.id = id;
+    e.port = port;
+    e.heartbeat = heartbeat;
+    e.time = par->getcurrtime();
+
+    // with PARTIAL_VIEW the ring would follow view churn and give no owners anyway
+    if (type == EVENT_JOINED && !par->PARTIAL_VIEW)
+    {
+        ring.add(memberKey(id, port));
+    }
+    else if (type == EVENT_REMOVED && !par->PARTIAL_VIEW)
+    {
+        ring.remove(memberKey(id, port));
+    }
+    else if (type == EVENT_JOINED)
+    {
+        MemberKey key = memberKey(id, port);
+        reportedNodes.insert(lower_bound(reportedNodes.begin(), reportedNodes.end(), key), key);
+    }
+    else if (type == EVENT_REMOVED)
+    {
+        CountedVector<MemberKey>::iterator it = lower_bound(reportedNodes.begin(), reportedNodes.end(), memberKey(id, port));
+        if (it != reportedNodes.end() && *it == memberKey(id, port))
+        {
+            reportedNodes.erase(it);
+        }
+    }
+    for (unsigned int i = 0; i < subscribers.size(); i++)
+    {
+        subscribers[i](e);
+    }
+    if (!events.push(e))
+    {
+        eventsLost++;
+    }
+    if (type == EVENT_JOINED || type == EVENT_REMOVED)
+    {
+        Address addr;
+        memcpy(addr.addr, &id, sizeof(int));
+        memcpy(&addr.addr[4], &port, sizeof(short));
+        if (type == EVENT_JOINED)
+        {
+            log->logNodeAdd(&memberNode->addr, &addr);
+        }
+        else
+        {
+            log->logNodeRemove(&memberNode->addr, &addr);
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: reportJoined
+ *
+ * DESCRIPTION: Partial view mode: report a member joined, unless it was already
+ * 				and hasn't been removed since
+ */
+void MP1Node::reportJoined(int id, short port, long heartbeat)
+{
+    MemberKey key = memberKey(id, port);
+    if (!binary_search(reportedNodes.begin(), reportedNodes.end(), key))
+    {
+        this->emitEvent(EVENT_JOINED, id, port, heartbeat);
+    }
+}
+
+/**
+ * FUNCTION NAME: subscribe
+ *
+ * DESCRIPTION: Have callback called with every membership event, on the thread
+ * 				running this node, as it happens. Register before the node runs.
+ */
+void MP1Node::subscribe(const MemberEventCallback &callback)
+{
+    subscribers.push_back(callback);
+}
+
+/**
+ * FUNCTION NAME: pollEvents
+ *
+ * DESCRIPTION: Take up to max membership events, oldest first, from one consumer thread
+ *
+ * RETURNS:
+ * number of events written to out
+ */
+int MP1Node::pollEvents(MemberEvent *out, int max)
+{
+    int n = 0;
+    while (n < max && events.pop(&out[n]))
+    {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * FUNCTION NAME: owners
+ *
+ * DESCRIPTION: The members that own key on the consistent-hash ring, the primary first
+ * 				and then the next replicas - 1 distinct members clockwise. With
+ * 				PARTIAL_VIEW each ring holds its own node's views only, so nodes
+ * 				disagree on owners and none are given.
+ *
+ * RETURNS:
+ * number of owners written to out, 0 in partial view mode
+ */
+int MP1Node::owners(const string &key, int replicas, vector<Address> &out)
+{
+    vector<MemberKey> keys;
+    out.clear();
+    if (par->PARTIAL_VIEW)
+    {
+        return 0;
+    }
+    ring.owners(HashRing::hashKey(key.data(), key.size()), replicas, keys);
+    for (unsigned int i = 0; i < keys.size(); i++)
+    {
+        Address a;
+        int id = (int)(keys[i] >> 16);
+        short port = (short)(keys[i] & 0xffff);
+        memcpy(a.addr, &id, sizeof(int));
+        memcpy(&a.addr[4], &port, sizeof(short));
+        out.push_back(a);
+    }
+    return out.size();
+}
+
+/**
+ * FUNCTION NAME: ringMatchesViews
+ *
+ * DESCRIPTION: Whether the ring holds exactly the members of our member list,
+ * 				or nothing in partial view mode, where it isn't maintained
+ */
+bool MP1Node::ringMatchesViews()
+{
+    MemberTable &members = memberNode->memberList;
+    if (par->RING_VNODES <= 0)
+    {
+        return true;
+    }
+    if (par->PARTIAL_VIEW)
+    {
+        return ring.size() == 0;
+    }
+    for (int i = 0; i < members.size(); i++)
+    {
+        if (!ring.contains(members.key(i)))
+        {
+            return false;
+        }
+    }
+    return ring.size() == members.size();
+}
+
+/**
+ * FUNCTION NAME: expireTombstones
+ *
+ * DESCRIPTION: Forget the tombstones older than TOMBSTONE_TTL, if it is set
+ */
+void MP1Node::expireTombstones()
+{
+    long now = par->getcurrtime();
+    unsigned int k = 0;
+
+    if (par->TOMBSTONE_TTL <= 0)
+    {
+        return;
+    }
+    for (unsigned int i = 0; i < deadNodes.size(); i++)
+    {
+        if (now - deadTimes[i] >= par->TOMBSTONE_TTL)
+        {
+            this->emitEvent(EVENT_TOMBSTONE_EXPIRED, (int)(deadNodes[i] >> 16), (short)(deadNodes[i] & 0xffff), 0);
+            continue;
+        }
+        deadNodes[k] = deadNodes[i];
+        deadTimes[k] = deadTimes[i];
+        deadIncarnations[k] = deadIncarnations[i];
+        k++;
+    }
+    deadNodes.resize(k);
+    deadTimes.resize(k);
+    deadIncarnations.resize(k);
+}
+
+/**
+ * FUNCTION NAME: isDead
+ *
+ * DESCRIPTION: Whether the member has a tombstone burying this incarnation of it.
+ * 				A later incarnation is a restarted process, which the tombstone
+ * 				doesn't block.
+ */
+bool MP1Node::isDead(MemberKey key, unsigned char incarnation)
+{
+    CountedVector<MemberKey>::iterator it = lower_bound(deadNodes.begin(), deadNodes.end(), key);
+    return it != deadNodes.end() && *it == key
+        && !newerIncarnation(incarnation, deadIncarnations[it - deadNodes.begin()]);
+}
+
+/**
+ * FUNCTION NAME: addTombstone
+ *
+ * DESCRIPTION: Remember a removed member so gossip can't add it back, keeping the tombstones sorted.
+ * 				The tombstone of an earlier incarnation is moved up to this one.
+ */
+void MP1Node::addTombstone(MemberKey key, unsigned char incarnation)
+{
+    CountedVector<MemberKey>::iterator it = lower_bound(deadNodes.begin(), deadNodes.end(), key);
+    int k = it - deadNodes.begin();
+    if (it == deadNodes.end() || *it != key)
+    {
+        deadTimes.insert(deadTimes.begin() + k, par->getcurrtime());
+        deadIncarnations.insert(deadIncarnations.begin() + k, incarnation);
+        deadNodes.insert(it, key);
+    }
+    else if (newerIncarnation(incarnation, deadIncarnations[k]))
+    {
+        deadTimes[k] = par->getcurrtime();
+        deadIncarnations[k] = incarnation;
+    }
+}
+
+/**
+ * FUNCTION NAME: probeBuried
+ *
+ * DESCRIPTION: PING a tombstoned member picked at random. A member removed only because
+ * 				it was out of reach, as behind a partition, answers with a DIS and both
+ * 				sides come back to each other's views.
+ */
+void MP1Node::probeBuried()
+{
+    if (deadNodes.empty())
+    {
+        return;
+    }
+    MemberKey key = deadNodes[this->nextrand() % deadNodes.size()];
+    MemberListEntry mle((int)(key >> 16), (short)(key & 0xffff));
+    Address dst_addr = mleAddress(&mle);
+    auto probe = this->serializeMSG(MsgTypes::PING);
+    this->send(&dst_addr, probe.second, probe.first);
+    free(probe.second);
+}
+
+/**
+ * FUNCTION NAME: answerBuried
+ *
+ * DESCRIPTION: Tell a sender we still hold a tombstone for, and have not taken back
+ * 				since, that it was removed, naming the incarnation we buried
+ */
+void MP1Node::answerBuried(Address *src_addr)
+{
+    int id = *(int *)src_addr->addr;
+    short port = *(short *)&src_addr->addr[4];
+    CountedVector<MemberKey>::iterator it = lower_bound(deadNodes.begin(), deadNodes.end(), memberKey(id, port));
+    if (it == deadNodes.end() || *it != memberKey(id, port)
+        || memberNode->memberList.find(id, port) >= 0 || passiveView.find(id, port) >= 0)
+    {
+        return;
+    }
+    MemberListEntry mle(id, port, 0, 0, deadIncarnations[it - deadNodes.begin()]);
+    int headerSize = sizeof(MessageHdr) + sizeof(Address);
+    int totalsize = headerSize + sizeof(MemberListEntry);
+    char *msg = (char *)malloc(totalsize * sizeof(char));
+
+    MessageHdr hdr;
+    hdr.msgType = MsgTypes::DIS;
+    memcpy(msg, &hdr, sizeof(MessageHdr));
+    memcpy(msg + sizeof(MessageHdr), &memberNode->addr, sizeof(Address));
+    memcpy(msg + headerSize, &mle, sizeof(MemberListEntry));
+    this->send(src_addr, msg, totalsize);
+    free(msg);
+}
+
+/*
+ * Handlers by message type, in MsgTypes order. Nodes never receive CHECK, nor SUS,
+ * suspicions being piggybacked instead.
+ */
+const MessageHandler MP1Node::handlers[DUMMYLASTMSGTYPE] = {
+    &MP1Node::dispatch<JoinReqView, &MP1Node::onJoinReq>,       // JOINREQ
+    &MP1Node::dispatch<EntryListView, &MP1Node::onJoinRep>,     // JOINREP
+    &MP1Node::dispatch<EntryListView, &MP1Node::onPing>,        // PING
+    NULL,                                                       // CHECK
+    &MP1Node::dispatch<EmptyView, &MP1Node::onIsAlive>,         // ISALIVE
+    NULL,                                                       // SUS
+    &MP1Node::dispatch<DisView, &MP1Node::removeNode>,          // DIS
+    &MP1Node::dispatch<DigestView, &MP1Node::onDigest>,         // DIGEST
+    &MP1Node::dispatch<DeltaView, &MP1Node::onDelta>,           // DELTA
+    &MP1Node::dispatch<EntryListView, &MP1Node::onShuffle>,     // SHUFFLE
+    &MP1Node::dispatch<EntryListView, &MP1Node::onShuffleRep>,  // SHUFFLEREP
+    &MP1Node::dispatch<EmptyView, &MP1Node::onDisconnect>,      // DISCONNECT
+};
+
+/**
+ * FUNCTION NAME: dispatch
+ *
+ * DESCRIPTION: Decode a message's payload into the handler's view and run the handler
+ *
+ * RETURNS:
+ * false if the payload is malformed
+ */
+template <typename View, void (MP1Node::*handle)(Address *, const View &)>
+bool MP1Node::dispatch(MessageView &msg)
+{
+    View view;
+    if (!view.parse(msg.payload(), msg.payloadSize()))
+    {
+        return false;
+    }
+    (this->*handle)(msg.source(), view);
+    return true;
+}
+
+/**
+ * FUNCTION NAME: recvCallBack
+ *
+ * DESCRIPTION: Message handler for different message types. A message is read in
+ * 				place; one that is truncated or whose counts overrun it is dropped.
+ * 				With RECONNECT_PERIOD set, a sender still buried once the message was
+ * 				handled is told so.
+ */
+bool MP1Node::recvCallBack(void *env, char *data, int size)
+{
+    MessageView msg;
+    if (!msg.parse(data, size) || handlers[msg.type()] == NULL)
+    {
+        log->LOG(&memberNode->addr, "Dropped a malformed message of %d bytes", size);
+        return false;
+    }
+    // membership updates ride between the sender's address and the payload
+    for (RecordList<MemberUpdate>::const_iterator u = msg.updates().begin(); u != msg.updates().end(); ++u)
+    {
+        this->applyUpdate(*u);
+    }
+    if (!(this->*handlers[msg.type()])(msg))
+    {
+        log->LOG(&memberNode->addr, "Dropped a malformed message of %d bytes", size);
+        return false;
+    }
+    if (par->RECONNECT_PERIOD > 0 && !deadNodes.empty())
+    {
+        this->answerBuried(msg.source());
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: nodeLoopOps
+ *
+ * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
+ * 				the nodes
+ * 				Propagate your membership list
+ */
+void MP1Node::nodeLoopOps()
+{
+    PHASE_TIMER(PHASE_NODE_LOOP_OPS);
+
+    /*
+     * Your code goes here
+     */
+    // if (par->getcurrtime() == 490) {
+    //     this->logMemberList();
+    // }
+    MemberTable &members = memberNode->memberList;
+    members.sweep(par->getcurrtime(), par->TREMOVE, par->TREMOVE + par->TFAIL, suspectMask, expiredMask);
+
+    newSuspects.clear();
+    for (unsigned int w = 0; w < suspectMask.size(); w++)
+    {
+        // a member that expires in this sweep is only removed, not suspected first
+        for (unsigned long long bits = suspectMask[w] & ~expiredMask[w]; bits != 0; bits &= bits - 1)
+        {
+            int s = w * 64 + __builtin_ctzll(bits);
+            newSuspects.push_back(members.key(s));
+            if (!binary_search(suspects.begin(), suspects.end(), members.key(s)))
+            {
+                this->emitEvent(EVENT_SUSPECTED, members.id(s), members.port(s), members.heartbeat(s));
+            }
+            this->disseminate(UPDATE_SUSPECT, members.entry(w * 64 + __builtin_ctzll(bits)));
+            if (par->PARTIAL_VIEW)
+            {
+                // few others watch an active peer, so probe it ourselves; its PING reply refreshes it
+                Address suspect = members.address(w * 64 + __builtin_ctzll(bits));
+                auto probe = this->serializeMSG(MsgTypes::ISALIVE);
+                this->send(&suspect, probe.second, probe.first);
+                free(probe.second);
+            }
+        }
+    }
+
+    expiredList.clear();
+    for (unsigned int w = 0; w < expiredMask.size(); w++)
+    {
+        for (unsigned long long bits = expiredMask[w]; bits != 0; bits &= bits - 1)
+        {
+            expiredList.push_back(members.entry(w * 64 + __builtin_ctzll(bits)));
+        }
+    }
+    if (!expiredList.empty())
+    {
+        members.removeMasked(expiredMask);
+        for (unsigned int j = 0; j < expiredList.size(); j++)
+        {
+            this->addTombstone(memberKey(expiredList[j].id, expiredList[j].port), expiredList[j].incarnation);
+            this->disseminate(UPDATE_DEAD, expiredList[j]);
+            this->emitEvent(EVENT_REMOVED, expiredList[j].id, expiredList[j].port, expiredList[j].heartbeat);
+        }
+    }
+    // a suspect no longer suspect and still here was heard from again
+    for (unsigned int j = 0; j < suspects.size(); j++)
+    {
+        if (!binary_search(newSuspects.begin(), newSuspects.end(), suspects[j]))
+        {
+            int i = members.find((int)(suspects[j] >> 16), (short)(suspects[j] & 0xffff));
+            if (i >= 0)
+            {
+                this->emitEvent(EVENT_REFUTED, members.id(i), members.port(i), members.heartbeat(i));
+            }
+        }
+    }
+    suspects.swap(newSuspects);
+    this->expireTombstones();
+    if (par->PARTIAL_VIEW)
+    {
+        this->fillActiveView();
+    }
+
+    memberNode->heartbeat++;
+    if (memberNode->heartbeat % 3 == 0)
+    {
+        this->updateMemberList(&memberNode->addr, memberNode->heartbeat, incarnation);
+        // digests only pay off when every node holds the whole group
+        this->sendMessageToKRand(par->DIGEST_RANGES > 0 && !par->PARTIAL_VIEW ? MsgTypes::DIGEST : MsgTypes::PING);
+    }
+    if (par->PARTIAL_VIEW && memberNode->heartbeat % par->SHUFFLE_PERIOD == 0)
+    {
+        this->sendShuffle();
+    }
+    if (par->RECONNECT_PERIOD > 0 && memberNode->heartbeat % par->RECONNECT_PERIOD == 0)
+    {
+        this->probeBuried();
+    }
+    this->publishView();
+    return;
+}
+
+/**
+ * FUNCTION NAME: isNullAddress
+ *
+ * DESCRIPTION: Function checks if the address is NULL
+ */
+int MP1Node::isNullAddress(Address *addr)
+{
+    return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+}
+
+/**
+ * FUNCTION NAME: getJoinAddress
+ *
+ * DESCRIPTION: Returns the Address of the introducer to ask next: the first
+ * 				introducer boots the group and gets its own address, others start
+ * 				at an introducer picked by their id, so joins spread over all of
+ * 				them, and move on to the next one on every retry
+ */
+Address MP1Node::getJoinAddress()
+{
+    Address joinaddr;
+    vector<int> &seeds = par->INTRODUCERS;
+    int self = *(int *)(&memberNode->addr.addr);
+    int k = seeds.size();
+    int seed = seeds[0];
+
+    if (self != seeds[0])
+    {
+        seed = seeds[(self + joinAttempts) % k];
+        if (seed == self)
+        {
+            seed = seeds[(self + joinAttempts + 1) % k];
+        }
+    }
+
+    memset(&joinaddr, 0, sizeof(Address));
+    *(int *)(&joinaddr.addr) = seed;
+    *(short *)(&joinaddr.addr[4]) = 0;
+
+    return joinaddr;
+}
+
+/**
+ * FUNCTION NAME: initMemberListTable
+ *
+ * DESCRIPTION: Initialize the membership list
+ */
+void MP1Node::initMemberListTable(Member *memberNode)
+{
+    memberNode->memberList.clear();
+    int id = *(int *)(&memberNode->addr.addr);
+    short port = *(short *)(&memberNode->addr.addr[4]);
+
+    MemberListEntry mle(id, port);
+    mle.settimestamp(par->getcurrtime());
     mle.setheartbeat(memberNode->heartbeat);
-    memberNode->memberList.push_back(mle);
+    mle.incarnation = incarnation;
+    memberNode->memberList.insert(mle);
+    ring.clear();
+    if (!par->PARTIAL_VIEW)
+    {
+        ring.add(memberKey(id, port));
+    }
     return;
 }
 
+/**
+ * FUNCTION NAME: writeEntries / readEntries / writeAddress / readAddress
+ *
+ * DESCRIPTION: Checkpoint helpers for membership entry vectors and addresses
+ */
+static void writeEntries(CheckpointWriter *w, vector<MemberListEntry> &entries)
+{
+    w->put<int>(entries.size());
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+        w->put<int>(entries[i].id);
+        w->put<short>(entries[i].port);
+        w->put<unsigned char>(entries[i].incarnation);
+        w->put<long>(entries[i].heartbeat);
+        w->put<long>(entries[i].timestamp);
+    }
+}
+
+static void readEntries(CheckpointReader *r, vector<MemberListEntry> &entries)
+{
+    int n = r->get<int>();
+    entries.clear();
+    for (int i = 0; i < n && r->ok(); i++)
+    {
+        int id = r->get<int>();
+        short port = r->get<short>();
+        unsigned char incarnation = r->get<unsigned char>();
+        long heartbeat = r->get<long>();
+        long timestamp = r->get<long>();
+        entries.push_back(MemberListEntry(id, port, heartbeat, timestamp, incarnation));
+    }
+}
+
+static void writeEntries(CheckpointWriter *w, MemberTable &table)
+{
+    vector<MemberListEntry> entries;
+    for (int i = 0; i < table.size(); i++)
+    {
+        entries.push_back(table.entry(i));
+    }
+    writeEntries(w, entries);
+}
+
+static void readEntries(CheckpointReader *r, MemberTable &table)
+{
+    vector<MemberListEntry> entries;
+    readEntries(r, entries);
+    sort(entries.begin(), entries.end(), mleLess);
+    table.clear();
+    table.merge(entries);
+}
+
+static void writeAddress(CheckpointWriter *w, const Address &addr)
+{
+    w->putBytes(addr.addr, sizeof(addr.addr));
+}
+
+static Address readAddress(CheckpointReader *r)
+{
+    Address addr;
+    addr.init();
+    const char *src = r->getBytes(sizeof(addr.addr));
+    if (src != NULL)
+    {
+        memcpy(addr.addr, src, sizeof(addr.addr));
+    }
+    return addr;
+}
+
+/**
+ * FUNCTION NAME: checkpoint
+ *
+ * DESCRIPTION: Save the member state and the protocol state of this node
+ */
+void MP1Node::checkpoint(CheckpointWriter *w)
+{
+    writeAddress(w, memberNode->addr);
+    w->put<bool>(memberNode->inited);
+    w->put<bool>(memberNode->inGroup);
+    w->put<bool>(memberNode->bFailed);
+    w->put<int>(memberNode->nnb);
+    w->put<long>(memberNode->heartbeat);
+    w->put<int>(memberNode->pingCounter);
+    w->put<int>(memberNode->timeOutCounter);
+    writeEntries(w, memberNode->memberList);
+
+    // Messages received but not yet handled
+    w->put<int>(memberNode->mp1q.size());
+    for (unsigned int k = 0; k < memberNode->mp1q.size(); k++)
+    {
+        w->put<int>(memberNode->mp1q.at(k).size);
+        w->putBytes(memberNode->mp1q.at(k).elt, memberNode->mp1q.at(k).size);
+    }
+
+    w->put<int>(deadNodes.size());
+    w->putBytes(deadNodes.data(), deadNodes.size() * sizeof(MemberKey));
+    w->putBytes(deadTimes.data(), deadTimes.size() * sizeof(long));
+    w->putBytes(deadIncarnations.data(), deadIncarnations.size());
+    w->put<int>(suspects.size());
+    w->putBytes(suspects.data(), suspects.size() * sizeof(MemberKey));
+    writeEntries(w, passiveView);
+    w->put<int>(reportedNodes.size());
+    w->putBytes(reportedNodes.data(), reportedNodes.size() * sizeof(MemberKey));
+    updates.checkpoint(w);
+    w->put<int>(joinAttempts);
+    w->put<long>(nextJoinAt);
+    w->put<unsigned char>(incarnation);
+    w->put<unsigned int>(randState);
+}
+
+/**
+ * FUNCTION NAME: restore
+ *
+ * DESCRIPTION: Load the state saved by checkpoint into this node
+ */
+int MP1Node::restore(CheckpointReader *r)
+{
+    int i, n;
+    Address addr = readAddress(r);
+    if (!(addr == memberNode->addr))
+    {
+        return FAILURE;
+    }
+    memberNode->inited = r->get<bool>();
+    memberNode->inGroup = r->get<bool>();
+    memberNode->bFailed = r->get<bool>();
+    memberNode->nnb = r->get<int>();
+    memberNode->heartbeat = r->get<long>();
+    memberNode->pingCounter = r->get<int>();
+    memberNode->timeOutCounter = r->get<int>();
+    readEntries(r, memberNode->memberList);
+
+    while (!memberNode->mp1q.empty())
+    {
+        memory.counter(MEM_INBOX)->remove(memberNode->mp1q.front().size);
+        EmulNet::ENfree((char *)memberNode->mp1q.front().elt);
+        memberNode->mp1q.pop();
+    }
+    n = r->get<int>();
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        int size = r->get<int>();
+        const char *src = r->getBytes(size);
+        if (src == NULL)
+        {
+            return FAILURE;
+        }
+        char *elt = EmulNet::ENalloc(size);
+        memcpy(elt, src, size);
+        this->enqueue(elt, size);
+    }
+
+    deadNodes.clear();
+    deadTimes.clear();
+    n = r->get<int>();
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        deadNodes.push_back(r->get<MemberKey>());
+    }
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        deadTimes.push_back(r->get<long>());
+    }
+    deadIncarnations.clear();
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        deadIncarnations.push_back(r->get<unsigned char>());
+    }
+    suspects.clear();
+    n = r->get<int>();
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        suspects.push_back(r->get<MemberKey>());
+    }
+    readEntries(r, passiveView);
+    reportedNodes.clear();
+    n = r->get<int>();
+    for (i = 0; i < n && r->ok(); i++)
+    {
+        reportedNodes.push_back(r->get<MemberKey>());
+    }
+    if (updates.restore(r) != SUCCESS)
+    {
+        return FAILURE;
+    }
+    joinAttempts = r->get<int>();
+    nextJoinAt = r->get<long>();
+    incarnation = r->get<unsigned char>();
+    randState = r->get<unsigned int>();
+    pendingJoins.clear();
+    // the ring holds what the member list holds, so it is rebuilt rather than saved
+    ring.clear();
+    for (i = 0; i < memberNode->memberList.size() && !par->PARTIAL_VIEW; i++)
+    {
+        ring.add(memberNode->memberList.key(i));
+    }
+    this->publishView();
+    return r->ok() ? SUCCESS : FAILURE;
+}
+
 /**
  * FUNCTION NAME: printAddress
  *
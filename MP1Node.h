@@ -14,41 +14,52 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
-
-/**
- * Macros
- */
-#define TREMOVE 20
-#define TFAIL 5
+#include "Checkpoint.h"
+#include "Dissemination.h"
+#include "Message.h"
+#include "Snapshot.h"
+#include "Ring.h"
+#include <functional>
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
 
 /**
- * Message Types
+ * Membership event types
  */
-enum MsgTypes
+enum MemberEventType
 {
-	JOINREQ,
-	JOINREP,
-	PING,
-	CHECK,
-	ISALIVE,
-	SUS,
-	DIS,
-	DUMMYLASTMSGTYPE
+	EVENT_JOINED,
+	EVENT_SUSPECTED,
+	EVENT_REFUTED,
+	EVENT_REMOVED,
+	EVENT_TOMBSTONE_EXPIRED
 };
 
 /**
- * STRUCT NAME: MessageHdr
+ * STRUCT NAME: MemberEvent
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: A change in a node's view of one member
  */
-typedef struct MessageHdr
+typedef struct MemberEvent
 {
-	enum MsgTypes msgType;
-} MessageHdr;
+	enum MemberEventType type;
+	int id;
+	short port;
+	long heartbeat;
+	long time;
+} MemberEvent;
+
+typedef function<void(const MemberEvent &)> MemberEventCallback;
+
+class MP1Node;
+
+/**
+ * Entry of the message dispatch table: decodes a message's payload into its
+ * typed view and runs the handler, or returns false if it is malformed
+ */
+typedef bool (MP1Node::*MessageHandler)(MessageView &msg);
 
 /**
  * CLASS NAME: MP1Node
@@ -63,9 +74,67 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
-	map<Address, vector<Address>> susTracker;
-	vector<MemberListEntry> mySusList;
-	set<Address> deadNodes;
+	// bytes held by the node's structures, declared before them
+	MemAccount memory;
+	// tombstones of removed members, sorted, the time each was laid and the incarnation it buries
+	CountedVector<MemberKey> deadNodes;
+	CountedVector<long> deadTimes;
+	CountedVector<unsigned char> deadIncarnations;
+	// partial view mode: members reported joined and not removed since, sorted
+	CountedVector<MemberKey> reportedNodes;
+	// restarts of this node's process and refutations of its removal, kept across restarts as if on disk
+	unsigned char incarnation;
+	// state of this node's random stream, seeded from SEED and its address, kept across restarts
+	unsigned int randState;
+	// members found suspect by the last sweep, sorted
+	vector<MemberKey> suspects;
+	vector<MemberKey> newSuspects;
+	// suspect and expired bitmasks of the last timeout sweep
+	vector<unsigned long long> suspectMask;
+	vector<unsigned long long> expiredMask;
+	// scratch lists of the last sweep and the last merge
+	vector<MemberListEntry> expiredList;
+	vector<MemberListEntry> newMembers;
+	// messages taken from the inbox in one drain, reused across ticks
+	vector<q_elt> inboxBatch;
+	// per range summary of the member list, valid while its changes() equals digestVersion
+	vector<unsigned long long> myDigest;
+	unsigned long digestVersion;
+	// tick at which each digest range was last asked for, so it is asked from one peer only
+	vector<int> digestWanted;
+	// partial view mode: peers known but not monitored, memberList being the active view
+	MemberTable passiveView;
+	// membership updates waiting to ride on outgoing messages
+	DisseminationBuffer updates;
+	// scratch for the updates picked for one message and the message carrying them
+	vector<MemberUpdate> piggyback;
+	vector<char> sendBuffer;
+	// one slice of a member list too long for a single message
+	vector<char> sliceBuffer;
+	// peers whose inbox refused a message at tick congestedAt; not sent to again that tick
+	vector<MemberKey> congested;
+	long congestedAt;
+	// joiners to answer with one shared JOINREP once the inbox is drained
+	vector<Address> pendingJoins;
+	// join attempts made so far and the tick of the next one while not in the group
+	int joinAttempts;
+	long nextJoinAt;
+	// read-only copy of the member list for other threads, republished when membership changes
+	RcuCell<MembershipSnapshot> view;
+	unsigned long viewVersion;
+	// membership events waiting to be polled, and the subscribers called as they happen
+	MpscQueue<MemberEvent> events;
+	atomic<long> eventsLost;
+	vector<MemberEventCallback> subscribers;
+	// consistent-hash ring over the members, kept in step with the joined and removed events;
+	// left empty with PARTIAL_VIEW
+	HashRing ring;
+	// incoming entries copied for sorting, when a sender's were out of order
+	vector<MemberListEntry> unsortedScratch;
+	// handler of each MsgTypes value, NULL for the types no node receives
+	static const MessageHandler handlers[DUMMYLASTMSGTYPE];
+	template <typename View, void (MP1Node::*handle)(Address *, const View &)>
+	bool dispatch(MessageView &msg);
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -73,11 +142,38 @@ public:
 	{
 		return memberNode;
 	}
+	// current membership, safe to call from any thread
+	shared_ptr<const MembershipSnapshot> snapshot() const
+	{
+		return view.load();
+	}
+	void publishView();
+	void subscribe(const MemberEventCallback &callback);
+	int pollEvents(MemberEvent *out, int max);
+	long lostEvents() const
+	{
+		return eventsLost.load();
+	}
+	void emitEvent(MemberEventType type, int id, short port, long heartbeat);
+	void reportJoined(int id, short port, long heartbeat);
+	void expireTombstones();
+	// shard owners of key; consistent across nodes in full view mode only, empty with PARTIAL_VIEW
+	int owners(const string &key, int replicas, vector<Address> &out);
+	bool ringMatchesViews();
+	MemAccount &memoryAccount()
+	{
+		return memory;
+	}
 	int recvLoop();
 	static int enqueueWrapper(void *env, char *buff, int size);
+	void enqueue(char *data, int size);
 	void nodeStart(char *servaddrstr, short serverport);
+	void restartNode(char *servaddrstr, short serverport);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
+	void sendJoinReq(Address *joinaddr);
+	void retryJoin();
+	void answerJoins();
 	int finishUpThisNode();
 	void nodeLoop();
 	void checkMessages();
@@ -87,17 +183,45 @@ public:
 	Address getJoinAddress();
 	void initMemberListTable(Member *memberNode);
 	void printAddress(Address *addr);
-	void onJoinReq(Address *addr, void *data, size_t size);
-	void onPing(Address *src_addr, void *data, size_t size);
-	void pingHeartbeat(Address *addr, void *data, size_t size);
-	bool updateMemberList(Address *addr, long heartbeat);
+	void onJoinReq(Address *src_addr, const JoinReqView &msg);
+	void onJoinRep(Address *src_addr, const EntryListView &msg);
+	void onPing(Address *src_addr, const EntryListView &msg);
+	void onIsAlive(Address *src_addr, const EmptyView &msg);
+	bool updateMemberList(Address *addr, long heartbeat, unsigned char incarnation);
+	void mergeMemberList(const EntryListView &incoming);
+	bool isDead(MemberKey key, unsigned char incarnation);
+	void addTombstone(MemberKey key, unsigned char incarnation);
+	void probeBuried();
+	void answerBuried(Address *src_addr);
 	void logMemberList();
 	void sendMessageToKRand(MsgTypes msg);
-	void onSus(Address *addr, void *data, size_t size);
 	void serializeVector(char *buffer, vector<MemberListEntry> &src);
+	void serializeTable(char *buffer, MemberTable &src);
 	pair<int, char *> serializeMSG(MsgTypes msgType);
-	vector<MemberListEntry> deserializePing(char *data);
-	void removeNode(Address* src_addr, void* data, size_t size);
+	void removeNode(Address *src_addr, const DisView &msg);
+	vector<unsigned long long> &digest();
+	void onDigest(Address *src_addr, const DigestView &msg);
+	void onDelta(Address *src_addr, const DeltaView &msg);
+	void sendDelta(Address *dst_addr, unsigned long long ranges, unsigned long long want);
+	int activeCount();
+	int nextrand();
+	int randomPeer(MemberTable &view, MemberKey except);
+	bool addToActive(const MemberListEntry &mle, bool force);
+	void addToPassive(const MemberListEntry &mle);
+	void mergePartialView(Address *src_addr, const EntryListView &incoming);
+	void fillActiveView();
+	void sendEntries(Address *dst_addr, MsgTypes msgType, vector<MemberListEntry> &entries);
+	void sendShuffle();
+	void onShuffle(Address *src_addr, const EntryListView &msg);
+	void onShuffleRep(Address *src_addr, const EntryListView &msg);
+	void onDisconnect(Address *src_addr, const EmptyView &msg);
+	int send(Address *dst_addr, char *msg, int size);
+	int transmit(Address *dst_addr, char *msg, int size);
+	int retransmitLimit();
+	void disseminate(UpdateType type, const MemberListEntry &mle);
+	bool applyUpdate(const MemberUpdate &u);
+	void checkpoint(CheckpointWriter *w);
+	int restore(CheckpointReader *r);
 	virtual ~MP1Node();
 
 	/* Free this after use
@@ -0,0 +1,116 @@
+/**********************************
+ * FILE NAME: MappedFile.cpp
+ *
+ * DESCRIPTION: Definition of the memory-mapped file wrapper
+ **********************************/
+
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Constructor
+ */
+MappedFile::MappedFile(): fd(-1), base(NULL), length(0), writable(false) {}
+
+/**
+ * Destructor
+ */
+MappedFile::~MappedFile() {
+	close(length);
+}
+
+/**
+ * FUNCTION NAME: openRead
+ *
+ * DESCRIPTION: Map an existing file read-only
+ */
+int MappedFile::openRead(const char *path) {
+	struct stat st;
+
+	fd = open(path, O_RDONLY);
+	if ( fd < 0 ) {
+		return FAILURE;
+	}
+	if ( fstat(fd, &st) != 0 || st.st_size == 0 ) {
+		::close(fd);
+		fd = -1;
+		return FAILURE;
+	}
+	length = st.st_size;
+	base = (char *) mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if ( base == MAP_FAILED ) {
+		base = NULL;
+		::close(fd);
+		fd = -1;
+		return FAILURE;
+	}
+	writable = false;
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: openWrite
+ *
+ * DESCRIPTION: Create (or truncate) a file and map it writable
+ */
+int MappedFile::openWrite(const char *path, size_t initialLength) {
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0 ) {
+		return FAILURE;
+	}
+	writable = true;
+	if ( resize(initialLength) != SUCCESS ) {
+		close(0);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: resize
+ *
+ * DESCRIPTION: Grow or shrink a writable mapping together with its file.
+ * 				On failure the mapping is gone but the file stays open until close.
+ */
+int MappedFile::resize(size_t newLength) {
+	if ( !writable || newLength == 0 ) {
+		return FAILURE;
+	}
+	if ( base != NULL ) {
+		munmap(base, length);
+		base = NULL;
+	}
+	if ( ftruncate(fd, newLength) != 0 ) {
+		return FAILURE;
+	}
+	base = (char *) mmap(NULL, newLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if ( base == MAP_FAILED ) {
+		base = NULL;
+		return FAILURE;
+	}
+	length = newLength;
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Unmap the file. A writable file is cut to finalLength bytes.
+ */
+int MappedFile::close(size_t finalLength) {
+	int ret = SUCCESS;
+	if ( base != NULL ) {
+		munmap(base, length);
+		base = NULL;
+	}
+	if ( fd >= 0 ) {
+		if ( writable && ftruncate(fd, finalLength) != 0 ) {
+			ret = FAILURE;
+		}
+		::close(fd);
+		fd = -1;
+	}
+	length = 0;
+	return ret;
+}
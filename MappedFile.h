@@ -0,0 +1,45 @@
+/**********************************
+ * FILE NAME: MappedFile.h
+ *
+ * DESCRIPTION: Header file of the memory-mapped file wrapper
+ **********************************/
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: MappedFile
+ *
+ * DESCRIPTION: A file mapped into memory, either read-only or as a
+ * 				writable region that can be grown and truncated on close
+ */
+class MappedFile {
+private:
+	int fd;
+	char *base;
+	size_t length;
+	bool writable;
+	MappedFile(const MappedFile &anotherFile);
+	MappedFile &operator=(const MappedFile &anotherFile);
+public:
+	MappedFile();
+	virtual ~MappedFile();
+	int openRead(const char *path);
+	int openWrite(const char *path, size_t initialLength);
+	int resize(size_t newLength);
+	int close(size_t finalLength);
+	char *data() {
+		return base;
+	}
+	size_t size() {
+		return length;
+	}
+	// true until close, even after a failed resize has lost the mapping
+	bool isOpen() {
+		return fd >= 0;
+	}
+};
+
+#endif /* _MAPPEDFILE_H_ */
@@ -0,0 +1,174 @@
+/**********************************
+ * FILE NAME: MemAccount.cpp
+ *
+ * DESCRIPTION: Definition of the per-node memory accounting and of the global
+ * 				allocation hooks
+ **********************************/
+
+#include "MemAccount.h"
+#include <malloc.h>
+#include <new>
+#include <atomic>
+
+/*
+ * What the calling thread allocated with new, in usable bytes, and the depth of
+ * its MemScopes. Counted only once a run asked for it.
+ */
+static atomic<bool> hooksOn(false);
+static thread_local long long threadLive = 0;
+static thread_local unsigned long long threadAllocs = 0;
+static thread_local unsigned long long threadAllocated = 0;
+static thread_local int scopeDepth = 0;
+
+void *operator new(size_t size) {
+	void *p = malloc(size > 0 ? size : 1);
+	if ( p == NULL ) {
+		throw bad_alloc();
+	}
+	if ( hooksOn.load(memory_order_relaxed) ) {
+		size_t usable = malloc_usable_size(p);
+		threadLive += usable;
+		threadAllocs++;
+		threadAllocated += usable;
+	}
+	return p;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+	if ( p != NULL && hooksOn.load(memory_order_relaxed) ) {
+		threadLive -= malloc_usable_size(p);
+	}
+	free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	operator delete(p);
+}
+
+/**
+ * Constructor
+ */
+MemAccount::MemAccount() {
+	memset(reported, 0, sizeof(reported));
+}
+
+/**
+ * FUNCTION NAME: name
+ *
+ * DESCRIPTION: Name of a structure in the report
+ */
+const char *MemAccount::name(MemStructure s) {
+	static const char *names[MEM_STRUCTURES] = {
+		"memberList", "passiveView", "tombstones", "inbox", "inFlight", "heap"
+	};
+	return names[s];
+}
+
+/**
+ * FUNCTION NAME: set
+ *
+ * DESCRIPTION: Take the figures of a structure counted elsewhere, such as in EmulNet
+ */
+void MemAccount::set(MemStructure s, long long live, unsigned long long allocated) {
+	counters[s].live = live;
+	counters[s].allocated = allocated;
+}
+
+/**
+ * FUNCTION NAME: tracked
+ *
+ * DESCRIPTION: Live bytes of the node's structures. The heap row is left out, as it
+ * 				includes the containers.
+ */
+long long MemAccount::tracked() const {
+	long long sum = 0;
+	for ( int s = 0; s < MEM_HEAP; s++ ) {
+		sum += counters[s].live;
+	}
+	return sum;
+}
+
+/**
+ * FUNCTION NAME: sample
+ *
+ * DESCRIPTION: Record the live bytes of this report and start a new allocation interval.
+ * 				A node keeps growing when its structures, or its heap, grew at every
+ * 				one of the last window reports.
+ *
+ * RETURNS:
+ * whether the node keeps growing, with the structure that grew most over the
+ * window and by how much
+ */
+bool MemAccount::sample(int window, MemStructure *fastest, long long *growth) {
+	for ( int s = 0; s < MEM_STRUCTURES; s++ ) {
+		history.push_back(counters[s].live);
+		reported[s] = counters[s].allocated;
+	}
+	int samples = history.size() / MEM_STRUCTURES;
+	if ( samples > window + 1 ) {
+		history.erase(history.begin(), history.begin() + (samples - window - 1) * MEM_STRUCTURES);
+		samples = window + 1;
+	}
+	if ( samples < window + 1 ) {
+		return false;
+	}
+
+	bool structures = true, heap = true;
+	for ( int k = 1; k < samples; k++ ) {
+		long long before = 0, after = 0;
+		for ( int s = 0; s < MEM_HEAP; s++ ) {
+			before += history[(k - 1) * MEM_STRUCTURES + s];
+			after += history[k * MEM_STRUCTURES + s];
+		}
+		structures = structures && after > before;
+		heap = heap && history[k * MEM_STRUCTURES + MEM_HEAP] > history[(k - 1) * MEM_STRUCTURES + MEM_HEAP];
+	}
+	if ( !structures && !heap ) {
+		return false;
+	}
+	*growth = 0;
+	*fastest = MEM_HEAP;
+	for ( int s = 0; s < MEM_STRUCTURES; s++ ) {
+		long long g = history[(samples - 1) * MEM_STRUCTURES + s] - history[s];
+		// the heap only when no structure of its own explains the growth
+		if ( s != MEM_HEAP && g > *growth ) {
+			*growth = g;
+			*fastest = (MemStructure)s;
+		}
+	}
+	if ( *growth == 0 ) {
+		*growth = history[(samples - 1) * MEM_STRUCTURES + MEM_HEAP] - history[MEM_HEAP];
+	}
+	return true;
+}
+
+/**
+ * Constructor, opening the scope
+ */
+MemScope::MemScope(MemCounter *counter): counter(scopeDepth++ == 0 ? counter : NULL),
+		live(threadLive), allocs(threadAllocs), allocated(threadAllocated) {}
+
+/**
+ * Destructor, charging the scope's allocations to its counter
+ */
+MemScope::~MemScope() {
+	scopeDepth--;
+	if ( counter != NULL ) {
+		counter->live += threadLive - live;
+		counter->allocs += threadAllocs - allocs;
+		counter->allocated += threadAllocated - allocated;
+	}
+}
+
+/**
+ * FUNCTION NAME: enableHooks
+ *
+ * DESCRIPTION: Start counting allocations; until then the hooks only pass them through
+ */
+void MemScope::enableHooks() {
+	hooksOn.store(true);
+}
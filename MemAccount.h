@@ -0,0 +1,133 @@
+/**********************************
+ * FILE NAME: MemAccount.h
+ *
+ * DESCRIPTION: Header file of the per-node memory accounting: counting allocators
+ * 				for the protocol's containers and global allocation hooks
+ **********************************/
+
+#ifndef _MEMACCOUNT_H_
+#define _MEMACCOUNT_H_
+
+#include "stdincludes.h"
+
+/**
+ * Accounted structures of a node
+ */
+enum MemStructure {
+	MEM_MEMBER_LIST,
+	MEM_PASSIVE_VIEW,
+	MEM_TOMBSTONES,
+	MEM_INBOX,			// received messages waiting in mp1q
+	MEM_IN_FLIGHT,		// messages on their way to the node, held by EmulNet
+	MEM_HEAP,			// everything allocated with new while the node runs
+	MEM_STRUCTURES
+};
+
+/**
+ * STRUCT NAME: MemCounter
+ *
+ * DESCRIPTION: Live bytes of one structure, and its allocations since the start
+ */
+typedef struct MemCounter {
+	long long live;
+	unsigned long long allocs;
+	unsigned long long allocated;
+	MemCounter(): live(0), allocs(0), allocated(0) {}
+	void add(size_t bytes) {
+		live += bytes;
+		allocs++;
+		allocated += bytes;
+	}
+	void remove(size_t bytes) {
+		live -= bytes;
+	}
+} MemCounter;
+
+/**
+ * CLASS NAME: CountingAllocator
+ *
+ * DESCRIPTION: Allocator charging what a container holds to a MemCounter, or to
+ * 				nothing when it has none. Moving a container into one moves the
+ * 				counter along, which is how an existing container is put on an account.
+ */
+template <typename T>
+class CountingAllocator {
+public:
+	typedef T value_type;
+	typedef true_type propagate_on_container_move_assignment;
+	MemCounter *counter;
+	CountingAllocator(): counter(NULL) {}
+	explicit CountingAllocator(MemCounter *counter): counter(counter) {}
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U> &other): counter(other.counter) {}
+	T *allocate(size_t n) {
+		if ( counter != NULL ) {
+			counter->add(n * sizeof(T));
+		}
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T *p, size_t n) {
+		if ( counter != NULL ) {
+			counter->remove(n * sizeof(T));
+		}
+		::operator delete(p);
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+	return a.counter == b.counter;
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+	return a.counter != b.counter;
+}
+
+template <typename T>
+using CountedVector = vector<T, CountingAllocator<T>>;
+
+/**
+ * CLASS NAME: MemAccount
+ *
+ * DESCRIPTION: The counters of one node's structures, and their live bytes at
+ * 				the last few reports to tell a node whose state keeps growing
+ */
+class MemAccount {
+private:
+	MemCounter counters[MEM_STRUCTURES];
+	// allocated bytes of each structure at the last report
+	unsigned long long reported[MEM_STRUCTURES];
+	// live bytes of each structure at the last reports, oldest first
+	vector<long long> history;
+public:
+	MemAccount();
+	static const char *name(MemStructure s);
+	MemCounter *counter(MemStructure s) { return &counters[s]; }
+	const MemCounter &get(MemStructure s) const { return counters[s]; }
+	void set(MemStructure s, long long live, unsigned long long allocated);
+	long long tracked() const;
+	unsigned long long allocatedSinceReport(MemStructure s) const { return counters[s].allocated - reported[s]; }
+	bool sample(int window, MemStructure *fastest, long long *growth);
+};
+
+/**
+ * CLASS NAME: MemScope
+ *
+ * DESCRIPTION: Charges what the calling thread allocates with new and frees with
+ * 				delete, from its construction to its destruction, to a counter.
+ * 				Nested scopes leave it to the outermost one.
+ */
+class MemScope {
+private:
+	MemCounter *counter;
+	long long live;
+	unsigned long long allocs;
+	unsigned long long allocated;
+public:
+	explicit MemScope(MemCounter *counter);
+	~MemScope();
+	static void enableHooks();
+};
+
+#endif /* _MEMACCOUNT_H_ */
@@ -5,10 +5,16 @@
  **********************************/
 
 #include "Member.h"
+#include <climits>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 /**
  * Constructor
  */
+q_elt::q_elt(): elt(NULL), size(0) {}
+
 q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
 
 /**
@@ -40,12 +46,13 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp, unsigned char incarnation): id(id), port(port),
+		incarnation(incarnation), heartbeat(heartbeat), timestamp(timestamp) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), incarnation(0) {}
 
 /**
  * Copy constructor
@@ -54,6 +61,7 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->heartbeat = anotherMLE.heartbeat;
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
+	this->incarnation = anotherMLE.incarnation;
 	this->timestamp = anotherMLE.timestamp;
 }
 
@@ -65,6 +73,7 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(heartbeat, temp.heartbeat);
 	swap(id, temp.id);
 	swap(port, temp.port);
+	swap(incarnation, temp.incarnation);
 	swap(timestamp, temp.timestamp);
 	return *this;
 }
@@ -141,6 +150,297 @@ void MemberListEntry::settimestamp(long timestamp) {
 	this->timestamp = timestamp;
 }
 
+/**
+ * FUNCTION NAME: rebase
+ *
+ * DESCRIPTION: Move the timestamp base so that timestamp fits a 32-bit offset
+ */
+void MemberTable::rebase(long timestamp) {
+	long newBase = timestamp;
+	for ( unsigned int i = 0; i < stamps.size(); i++ ) {
+		long offset = base + stamps[i] - newBase;
+		stamps[i] = offset < INT_MIN ? INT_MIN : (offset > INT_MAX ? INT_MAX : (int)offset);
+	}
+	base = newBase;
+}
+
+/**
+ * FUNCTION NAME: settimestamp
+ *
+ * DESCRIPTION: setter
+ */
+void MemberTable::settimestamp(int i, long timestamp) {
+	if ( timestamp - base > INT_MAX || timestamp - base < INT_MIN ) {
+		rebase(timestamp);
+	}
+	stamps[i] = (int)(timestamp - base);
+}
+
+/**
+ * FUNCTION NAME: setincarnation
+ *
+ * DESCRIPTION: The i-th member restarted: a new process took its place, which
+ * 				counts as a change of membership
+ */
+void MemberTable::setincarnation(int i, unsigned char incarnation) {
+	incarnations[i] = incarnation;
+	version++;
+	memberVersion++;
+}
+
+/**
+ * FUNCTION NAME: entry
+ *
+ * DESCRIPTION: The i-th member as a MemberListEntry
+ */
+MemberListEntry MemberTable::entry(int i) const {
+	return MemberListEntry(ids[i], ports[i], heartbeats[i], timestamp(i), incarnations[i]);
+}
+
+/**
+ * FUNCTION NAME: entries
+ *
+ * DESCRIPTION: All members as MemberListEntry, in key order
+ */
+vector<MemberListEntry> MemberTable::entries() const {
+	vector<MemberListEntry> all;
+	all.reserve(ids.size());
+	for ( unsigned int i = 0; i < ids.size(); i++ ) {
+		all.push_back(entry(i));
+	}
+	return all;
+}
+
+/**
+ * FUNCTION NAME: address
+ *
+ * DESCRIPTION: Address of the i-th member
+ */
+Address MemberTable::address(int i) const {
+	Address a;
+	memcpy(a.addr, &ids[i], sizeof(int));
+	memcpy(&a.addr[4], &ports[i], sizeof(short));
+	return a;
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: Index of the first member whose key is not below (id, port)
+ */
+int MemberTable::lowerBound(int id, short port) const {
+	MemberKey k = memberKey(id, port);
+	int lo = lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+	int n = ids.size();
+	while ( lo < n && ids[lo] == id && key(lo) < k ) {
+		lo++;
+	}
+	return lo;
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Index of the member with this id and port, -1 if there is none
+ */
+int MemberTable::find(int id, short port) const {
+	int i = lowerBound(id, port);
+	if ( i < (int)ids.size() && ids[i] == id && ports[i] == port ) {
+		return i;
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Add a member at its sorted position
+ */
+void MemberTable::insert(const MemberListEntry &mle) {
+	int i = lowerBound(mle.id, mle.port);
+	if ( ids.empty() ) {
+		base = mle.timestamp;
+	}
+	ids.insert(ids.begin() + i, mle.id);
+	ports.insert(ports.begin() + i, mle.port);
+	heartbeats.insert(heartbeats.begin() + i, mle.heartbeat);
+	stamps.insert(stamps.begin() + i, 0);
+	incarnations.insert(incarnations.begin() + i, mle.incarnation);
+	settimestamp(i, mle.timestamp);
+	version++;
+	memberVersion++;
+}
+
+/**
+ * FUNCTION NAME: merge
+ *
+ * DESCRIPTION: Add new members, sorted by key and none of them present yet,
+ * 				in a single backwards merge pass
+ */
+void MemberTable::merge(const vector<MemberListEntry> &sorted) {
+	int m = ids.size();
+	int n = sorted.size();
+	int i = m - 1, j = n - 1, k = m + n - 1;
+
+	if ( n == 0 ) {
+		return;
+	}
+	if ( m == 0 ) {
+		base = sorted[0].timestamp;
+	}
+	version++;
+	memberVersion++;
+	ids.resize(m + n);
+	ports.resize(m + n);
+	heartbeats.resize(m + n);
+	stamps.resize(m + n);
+	incarnations.resize(m + n);
+
+	while ( j >= 0 ) {
+		if ( i >= 0 && key(i) > memberKey(sorted[j].id, sorted[j].port) ) {
+			ids[k] = ids[i];
+			ports[k] = ports[i];
+			heartbeats[k] = heartbeats[i];
+			stamps[k] = stamps[i];
+			incarnations[k] = incarnations[i];
+			i--;
+		}
+		else {
+			ids[k] = sorted[j].id;
+			ports[k] = sorted[j].port;
+			heartbeats[k] = sorted[j].heartbeat;
+			settimestamp(k, sorted[j].timestamp);
+			incarnations[k] = sorted[j].incarnation;
+			j--;
+		}
+		k--;
+	}
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Remove the i-th member
+ */
+void MemberTable::remove(int i) {
+	ids.erase(ids.begin() + i);
+	ports.erase(ports.begin() + i);
+	heartbeats.erase(heartbeats.begin() + i);
+	stamps.erase(stamps.begin() + i);
+	incarnations.erase(incarnations.begin() + i);
+	version++;
+	memberVersion++;
+}
+
+/**
+ * FUNCTION NAME: removeMasked
+ *
+ * DESCRIPTION: Remove every member whose bit is set in mask, in one compaction pass
+ */
+void MemberTable::removeMasked(const vector<unsigned long long> &mask) {
+	int n = ids.size();
+	int k = 0;
+	for ( int i = 0; i < n; i++ ) {
+		if ( (mask[i >> 6] >> (i & 63)) & 1 ) {
+			continue;
+		}
+		ids[k] = ids[i];
+		ports[k] = ports[i];
+		heartbeats[k] = heartbeats[i];
+		stamps[k] = stamps[i];
+		incarnations[k] = incarnations[i];
+		k++;
+	}
+	ids.resize(k);
+	ports.resize(k);
+	heartbeats.resize(k);
+	stamps.resize(k);
+	incarnations.resize(k);
+	version++;
+	memberVersion++;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove all members
+ */
+void MemberTable::clear() {
+	ids.clear();
+	ports.clear();
+	heartbeats.clear();
+	stamps.clear();
+	incarnations.clear();
+	base = 0;
+	version++;
+	memberVersion++;
+}
+
+/**
+ * FUNCTION NAME: account
+ *
+ * DESCRIPTION: Charge the table's columns to a counter from now on
+ */
+void MemberTable::account(MemCounter *counter) {
+	ids = CountedVector<int>(ids.begin(), ids.end(), CountingAllocator<int>(counter));
+	ports = CountedVector<short>(ports.begin(), ports.end(), CountingAllocator<short>(counter));
+	heartbeats = CountedVector<long>(heartbeats.begin(), heartbeats.end(), CountingAllocator<long>(counter));
+	stamps = CountedVector<int>(stamps.begin(), stamps.end(), CountingAllocator<int>(counter));
+	incarnations = CountedVector<unsigned char>(incarnations.begin(), incarnations.end(), CountingAllocator<unsigned char>(counter));
+}
+
+/**
+ * FUNCTION NAME: sweep
+ *
+ * DESCRIPTION: Timeout check over the whole table.
+ * 				Bit i of suspect is set when now - timestamp(i) > suspectAfter,
+ * 				bit i of expired when now - timestamp(i) > expireAfter.
+ * 				Compares 8 (AVX2) or 4 (SSE2) packed timestamps at a time.
+ */
+void MemberTable::sweep(long now, long suspectAfter, long expireAfter, vector<unsigned long long> &suspect, vector<unsigned long long> &expired) const {
+	int n = stamps.size();
+	int i = 0;
+	// Both conditions become stamp < cut on the relative timestamps
+	long scut = now - base - suspectAfter;
+	long ecut = now - base - expireAfter;
+	int suspectCut = scut < INT_MIN ? INT_MIN : (scut > INT_MAX ? INT_MAX : (int)scut);
+	int expireCut = ecut < INT_MIN ? INT_MIN : (ecut > INT_MAX ? INT_MAX : (int)ecut);
+	const int *t = stamps.data();
+
+	suspect.assign((n + 63) / 64, 0);
+	expired.assign((n + 63) / 64, 0);
+
+#if defined(__AVX2__)
+	__m256i scut8 = _mm256_set1_epi32(suspectCut);
+	__m256i ecut8 = _mm256_set1_epi32(expireCut);
+	for ( ; i + 8 <= n; i += 8 ) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(t + i));
+		unsigned long long sbits = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(scut8, v)));
+		unsigned long long ebits = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(ecut8, v)));
+		suspect[i >> 6] |= sbits << (i & 63);
+		expired[i >> 6] |= ebits << (i & 63);
+	}
+#elif defined(__SSE2__)
+	__m128i scut4 = _mm_set1_epi32(suspectCut);
+	__m128i ecut4 = _mm_set1_epi32(expireCut);
+	for ( ; i + 4 <= n; i += 4 ) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(t + i));
+		unsigned long long sbits = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(scut4, v)));
+		unsigned long long ebits = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(ecut4, v)));
+		suspect[i >> 6] |= sbits << (i & 63);
+		expired[i >> 6] |= ebits << (i & 63);
+	}
+#endif
+	for ( ; i < n; i++ ) {
+		if ( t[i] < suspectCut ) {
+			suspect[i >> 6] |= 1ULL << (i & 63);
+		}
+		if ( t[i] < expireCut ) {
+			expired[i >> 6] |= 1ULL << (i & 63);
+		}
+	}
+}
+
 /**
  * Copy Constructor
  */
@@ -154,7 +454,6 @@ Member::Member(const Member &anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
 	this->mp1q = anotherMember.mp1q;
 }
 
@@ -171,7 +470,6 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
 	this->mp1q = anotherMember.mp1q;
 	return *this;
 }
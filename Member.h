@@ -8,6 +8,7 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "MemAccount.h"
 
 /**
  * CLASS NAME: q_elt
@@ -19,9 +20,78 @@ class q_elt
 public:
 	void *elt;
 	int size;
+	q_elt();
 	q_elt(void *elt, int size);
 };
 
+/**
+ * CLASS NAME: RingQueue
+ *
+ * DESCRIPTION: FIFO ring buffer with a power-of-two capacity. Slots are reused
+ * 				in place, so push and pop never allocate; the buffer only doubles
+ * 				when a push finds it full. head and tail count up freely and are
+ * 				masked on access, so size() is tail - head even after wrap-around.
+ */
+template <typename T>
+class RingQueue
+{
+private:
+	vector<T> slots;
+	unsigned int mask;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int highWater;
+	void grow() {
+		vector<T> bigger(slots.size() * 2);
+		unsigned int n = size();
+		for (unsigned int i = 0; i < n; i++) {
+			bigger[i] = slots[(head + i) & mask];
+		}
+		slots.swap(bigger);
+		mask = slots.size() - 1;
+		head = 0;
+		tail = n;
+	}
+public:
+	explicit RingQueue(unsigned int capacity = 16) : mask(0), head(0), tail(0), highWater(0) {
+		unsigned int c = 1;
+		while (c < capacity) {
+			c <<= 1;
+		}
+		slots.resize(c);
+		mask = c - 1;
+	}
+	unsigned int size() const { return tail - head; }
+	bool empty() const { return tail == head; }
+	unsigned int capacity() const { return slots.size(); }
+	// most messages ever waiting at once
+	unsigned int highWaterMark() const { return highWater; }
+	// i-th waiting element, 0 being the oldest
+	const T &at(unsigned int i) const { return slots[(head + i) & mask]; }
+	const T &front() const { return slots[head & mask]; }
+	void push(const T &e) {
+		if (size() == slots.size()) {
+			grow();
+		}
+		slots[tail++ & mask] = e;
+		if (size() > highWater) {
+			highWater = size();
+		}
+	}
+	void pop() { head++; }
+	/**
+	 * Move up to max of the oldest elements into out, returning how many were taken
+	 */
+	unsigned int drain(T *out, unsigned int max) {
+		unsigned int n = size() < max ? size() : max;
+		for (unsigned int i = 0; i < n; i++) {
+			out[i] = slots[(head + i) & mask];
+		}
+		head += n;
+		return n;
+	}
+};
+
 /**
  * CLASS NAME: Address
  *
@@ -72,11 +142,13 @@ class MemberListEntry
 public:
 	int id;
 	short port;
+	// restarts of the member's process, in what was padding before heartbeat
+	unsigned char incarnation;
 	long heartbeat;
 	long timestamp;
-	MemberListEntry(int id, short port, long heartbeat, long timestamp);
+	MemberListEntry(int id, short port, long heartbeat, long timestamp, unsigned char incarnation = 0);
 	MemberListEntry(int id, short port);
-	MemberListEntry() : id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry() : id(0), port(0), incarnation(0), heartbeat(0), timestamp(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry &operator=(const MemberListEntry &anotherMLE);
 	int getid();
@@ -89,6 +161,122 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/**
+ * Sort key of a member: its id, then its port
+ */
+typedef long long MemberKey;
+
+inline MemberKey memberKey(int id, short port)
+{
+	return ((MemberKey)id << 16) | (unsigned short)port;
+}
+
+/**
+ * Whether incarnation a of a member started after incarnation b. Incarnations
+ * wrap around, so a is later when it is less than 128 restarts ahead of b.
+ */
+inline bool newerIncarnation(unsigned char a, unsigned char b)
+{
+	return (signed char)(a - b) > 0;
+}
+
+/**
+ * Whether the state (incarnation, heartbeat) of a member is newer than (otherIncarnation,
+ * otherHeartbeat): a later incarnation wins whatever its heartbeat, as it counts from 0 again
+ */
+inline bool newerState(unsigned char incarnation, long heartbeat, unsigned char otherIncarnation, long otherHeartbeat)
+{
+	if ( incarnation != otherIncarnation ) {
+		return newerIncarnation(incarnation, otherIncarnation);
+	}
+	return heartbeat > otherHeartbeat;
+}
+
+/**
+ * CLASS NAME: MemberTable
+ *
+ * DESCRIPTION: Membership table stored as a structure of arrays.
+ * 				Timestamps are kept as 32-bit offsets from a per-table base,
+ * 				so the timeout sweep only streams through a packed int array.
+ * 				Entries are kept sorted by member key, so incoming lists merge in one pass.
+ */
+class MemberTable
+{
+private:
+	CountedVector<int> ids;
+	CountedVector<short> ports;
+	CountedVector<long> heartbeats;
+	CountedVector<int> stamps;
+	CountedVector<unsigned char> incarnations;
+	long base;
+	// bumped by every change to the members or their heartbeats
+	unsigned long version;
+	// bumped only when members join or leave the table
+	unsigned long memberVersion;
+	void rebase(long timestamp);
+public:
+	MemberTable() : base(0), version(0), memberVersion(0) {}
+	int size() const
+	{
+		return ids.size();
+	}
+	bool empty() const
+	{
+		return ids.empty();
+	}
+	int id(int i) const
+	{
+		return ids[i];
+	}
+	short port(int i) const
+	{
+		return ports[i];
+	}
+	long heartbeat(int i) const
+	{
+		return heartbeats[i];
+	}
+	long timestamp(int i) const
+	{
+		return base + stamps[i];
+	}
+	unsigned char incarnation(int i) const
+	{
+		return incarnations[i];
+	}
+	void setheartbeat(int i, long heartbeat)
+	{
+		heartbeats[i] = heartbeat;
+		version++;
+	}
+	void setincarnation(int i, unsigned char incarnation);
+	unsigned long changes() const
+	{
+		return version;
+	}
+	unsigned long membershipChanges() const
+	{
+		return memberVersion;
+	}
+	void settimestamp(int i, long timestamp);
+	MemberKey key(int i) const
+	{
+		return memberKey(ids[i], ports[i]);
+	}
+	MemberListEntry entry(int i) const;
+	vector<MemberListEntry> entries() const;
+	Address address(int i) const;
+	int lowerBound(int id, short port) const;
+	int find(int id, short port) const;
+	void insert(const MemberListEntry &mle);
+	void merge(const vector<MemberListEntry> &sorted);
+	void remove(int i);
+	void removeMasked(const vector<unsigned long long> &mask);
+	void clear();
+	void sweep(long now, long suspectAfter, long expireAfter, vector<unsigned long long> &suspect, vector<unsigned long long> &expired) const;
+	void account(MemCounter *counter);
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -98,6 +286,7 @@ public:
 class Member
 {
 public:
+	// Fields read by the loops over every node come first, ahead of the tables
 	// This member's Address
 	Address addr;
 	// boolean indicating if this member is up
@@ -115,11 +304,9 @@ public:
 	// counter for ping timeout
 	int timeOutCounter;
 	// Membership table
-	vector<MemberListEntry> memberList;
-	// My position in the membership table
-	vector<MemberListEntry>::iterator myPos;
-	// Queue for failure detection messages
-	queue<q_elt> mp1q;
+	MemberTable memberList;
+	// Inbox for failure detection messages
+	RingQueue<q_elt> mp1q;
 	/**
 	 * Constructor
 	 */
@@ -0,0 +1,281 @@
+/**********************************
+ * FILE NAME: Message.h
+ *
+ * DESCRIPTION: Message types of the membership protocol and read-only views
+ * 				over received messages
+ **********************************/
+
+#ifndef _MESSAGE_H_
+#define _MESSAGE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "Dissemination.h"
+
+/**
+ * Message Types
+ */
+enum MsgTypes
+{
+	JOINREQ,
+	JOINREP,
+	PING,
+	CHECK,
+	ISALIVE,
+	SUS,
+	DIS,
+	DIGEST,
+	DELTA,
+	SHUFFLE,
+	SHUFFLEREP,
+	DISCONNECT,
+	DUMMYLASTMSGTYPE
+};
+
+/**
+ * STRUCT NAME: MessageHdr
+ *
+ * DESCRIPTION: Header and content of a message
+ */
+typedef struct MessageHdr
+{
+	enum MsgTypes msgType;
+} MessageHdr;
+
+/**
+ * CLASS NAME: RecordList
+ *
+ * DESCRIPTION: Read-only view over n records of type T packed in a received
+ * 				buffer. The buffer need not be aligned: records are copied out
+ * 				one at a time as they are read, and nothing is allocated.
+ */
+template <typename T>
+class RecordList {
+private:
+	const char *data;
+	int n;
+public:
+	class const_iterator {
+	private:
+		const char *p;
+	public:
+		typedef forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const T *pointer;
+		typedef T reference;
+		explicit const_iterator(const char *p) : p(p) {}
+		T operator*() const {
+			T record;
+			memcpy((char *)&record, p, sizeof(T));
+			return record;
+		}
+		const_iterator &operator++() {
+			p += sizeof(T);
+			return *this;
+		}
+		bool operator==(const const_iterator &other) const { return p == other.p; }
+		bool operator!=(const const_iterator &other) const { return p != other.p; }
+	};
+	RecordList() : data(NULL), n(0) {}
+	/**
+	 * View count records at data, of which size bytes are readable
+	 *
+	 * RETURNS:
+	 * bytes taken, or -1 if the records don't fit
+	 */
+	int parse(const char *data, size_t size, int count) {
+		if ( count < 0 || (size_t)count > size / sizeof(T) ) {
+			return -1;
+		}
+		this->data = data;
+		this->n = count;
+		return count * sizeof(T);
+	}
+	int size() const { return n; }
+	bool empty() const { return n == 0; }
+	T operator[](int i) const {
+		T record;
+		memcpy((char *)&record, data + i * sizeof(T), sizeof(T));
+		return record;
+	}
+	const_iterator begin() const { return const_iterator(data); }
+	const_iterator end() const { return const_iterator(data + n * sizeof(T)); }
+};
+
+/**
+ * CLASS NAME: MessageView
+ *
+ * DESCRIPTION: A received message as {MessageHdr, Address, unsigned char n,
+ * 				n MemberUpdate, payload}, checked for size. The payload is left
+ * 				to the view of the message's type.
+ */
+class MessageView {
+private:
+	MsgTypes msgType;
+	Address src;
+	RecordList<MemberUpdate> piggyback;
+	const char *body;
+	size_t bodySize;
+public:
+	MessageView() : msgType(DUMMYLASTMSGTYPE), body(NULL), bodySize(0) {}
+	bool parse(const char *data, size_t size) {
+		size_t header = sizeof(MessageHdr) + sizeof(Address);
+		int type;
+		if ( size < header + 1 ) {
+			return false;
+		}
+		memcpy(&type, data, sizeof(int));
+		if ( type < 0 || type >= DUMMYLASTMSGTYPE ) {
+			return false;
+		}
+		msgType = (MsgTypes)type;
+		memcpy(src.addr, data + sizeof(MessageHdr), sizeof(src.addr));
+		int used = piggyback.parse(data + header + 1, size - header - 1, (unsigned char)data[header]);
+		if ( used < 0 ) {
+			return false;
+		}
+		body = data + header + 1 + used;
+		bodySize = size - header - 1 - used;
+		return true;
+	}
+	MsgTypes type() const { return msgType; }
+	Address *source() { return &src; }
+	const RecordList<MemberUpdate> &updates() const { return piggyback; }
+	const char *payload() const { return body; }
+	size_t payloadSize() const { return bodySize; }
+};
+
+/*
+ * Payload views, one per message format. Each parse checks that the payload
+ * holds what its counts announce and views it in place.
+ */
+
+/**
+ * CLASS NAME: EmptyView
+ *
+ * DESCRIPTION: ISALIVE and DISCONNECT carry nothing besides the header
+ */
+class EmptyView {
+public:
+	bool parse(const char *data, size_t size) {
+		return true;
+	}
+};
+
+/**
+ * CLASS NAME: JoinReqView
+ *
+ * DESCRIPTION: JOINREQ: {unsigned char incarnation, long heartbeat}
+ */
+class JoinReqView {
+private:
+	unsigned char inc;
+	long hb;
+public:
+	JoinReqView() : inc(0), hb(0) {}
+	bool parse(const char *data, size_t size) {
+		if ( size < 1 + sizeof(long) ) {
+			return false;
+		}
+		inc = (unsigned char)data[0];
+		memcpy(&hb, data + 1, sizeof(long));
+		return true;
+	}
+	unsigned char incarnation() const { return inc; }
+	long heartbeat() const { return hb; }
+};
+
+/**
+ * CLASS NAME: EntryListView
+ *
+ * DESCRIPTION: JOINREP, PING, SHUFFLE and SHUFFLEREP: {int n, n MemberListEntry}
+ */
+class EntryListView : public RecordList<MemberListEntry> {
+public:
+	bool parse(const char *data, size_t size) {
+		int n;
+		if ( size < sizeof(int) ) {
+			return false;
+		}
+		memcpy(&n, data, sizeof(int));
+		return RecordList<MemberListEntry>::parse(data + sizeof(int), size - sizeof(int), n) >= 0;
+	}
+	/**
+	 * Whether the entries are in member key order, as a sender's table is
+	 */
+	bool sorted() const {
+		MemberKey last = 0;
+		bool first = true;
+		for ( const_iterator it = begin(); it != end(); ++it ) {
+			MemberListEntry e = *it;
+			MemberKey key = memberKey(e.id, e.port);
+			if ( !first && key < last ) {
+				return false;
+			}
+			last = key;
+			first = false;
+		}
+		return true;
+	}
+};
+
+/**
+ * CLASS NAME: DisView
+ *
+ * DESCRIPTION: DIS: {MemberListEntry} of the removed member
+ */
+class DisView {
+private:
+	MemberListEntry e;
+public:
+	bool parse(const char *data, size_t size) {
+		if ( size < sizeof(MemberListEntry) ) {
+			return false;
+		}
+		memcpy((char *)&e, data, sizeof(MemberListEntry));
+		return true;
+	}
+	const MemberListEntry &entry() const { return e; }
+};
+
+/**
+ * CLASS NAME: DigestView
+ *
+ * DESCRIPTION: DIGEST: {int n, n unsigned long long range summaries}
+ */
+class DigestView : public RecordList<unsigned long long> {
+public:
+	bool parse(const char *data, size_t size) {
+		int n;
+		if ( size < sizeof(int) ) {
+			return false;
+		}
+		memcpy(&n, data, sizeof(int));
+		return RecordList<unsigned long long>::parse(data + sizeof(int), size - sizeof(int), n) >= 0;
+	}
+};
+
+/**
+ * CLASS NAME: DeltaView
+ *
+ * DESCRIPTION: DELTA: {unsigned long long want, int n, n MemberListEntry}
+ */
+class DeltaView {
+private:
+	unsigned long long wanted;
+	EntryListView list;
+public:
+	DeltaView() : wanted(0) {}
+	bool parse(const char *data, size_t size) {
+		if ( size < sizeof(unsigned long long) ) {
+			return false;
+		}
+		memcpy(&wanted, data, sizeof(unsigned long long));
+		return list.parse(data + sizeof(unsigned long long), size - sizeof(unsigned long long));
+	}
+	unsigned long long want() const { return wanted; }
+	const EntryListView &entries() const { return list; }
+};
+
+#endif /* _MESSAGE_H_ */
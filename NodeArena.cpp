@@ -0,0 +1,77 @@
+/**********************************
+ * FILE NAME: NodeArena.cpp
+ *
+ * DESCRIPTION: Definition of the arena holding every node of a run
+ **********************************/
+
+#include "NodeArena.h"
+
+/*
+ * Bytes from the start of the arena to the next region, rounded up to ARENA_ALIGN
+ */
+static size_t regionEnd(size_t offset, size_t bytes) {
+	return (offset + bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+}
+
+/**
+ * Constructor
+ */
+NodeArena::NodeArena(): block(NULL), count(0), starts(NULL), members(NULL), nodes(NULL) {}
+
+/**
+ * Destructor
+ */
+NodeArena::~NodeArena() {
+	destroy();
+}
+
+/**
+ * FUNCTION NAME: create
+ *
+ * DESCRIPTION: Lay out the regions for EN_GPSZ nodes in one allocation and construct
+ * 				each node's Member and MP1Node in place, giving it its EmulNet address
+ */
+void NodeArena::create(Params *par, EmulNet *en, Log *log) {
+	int i;
+	destroy();
+	count = par->EN_GPSZ;
+
+	size_t memberAt = regionEnd(0, count * sizeof(int));
+	size_t nodeAt = regionEnd(memberAt, count * sizeof(MemberSlot));
+	size_t total = regionEnd(nodeAt, count * sizeof(MP1Node));
+	void *p = NULL;
+	if ( posix_memalign(&p, ARENA_ALIGN, max(total, (size_t)ARENA_ALIGN)) != 0 ) {
+		throw bad_alloc();
+	}
+	block = (char *)p;
+	starts = (int *)block;
+	members = (MemberSlot *)(block + memberAt);
+	nodes = (MP1Node *)(block + nodeAt);
+
+	for ( i = 0; i < count; i++ ) {
+		Address addr;
+		starts[i] = (int)(par->STEP_RATE*i);
+		new (&members[i].member) Member;
+		en->ENinit(&addr, par->PORTNUM);
+		new (nodes + i) MP1Node(&members[i].member, par, en, log, &addr);
+	}
+}
+
+/**
+ * FUNCTION NAME: destroy
+ *
+ * DESCRIPTION: Destroy every node and release the arena
+ */
+void NodeArena::destroy() {
+	// A Member's table is charged to its MP1Node's account, so it goes first
+	for ( int i = 0; i < count; i++ ) {
+		members[i].member.~Member();
+		nodes[i].~MP1Node();
+	}
+	free(block);
+	block = NULL;
+	count = 0;
+	starts = NULL;
+	members = NULL;
+	nodes = NULL;
+}
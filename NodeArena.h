@@ -0,0 +1,62 @@
+/**********************************
+ * FILE NAME: NodeArena.h
+ *
+ * DESCRIPTION: Header file of the arena holding every node of a run
+ **********************************/
+
+#ifndef _NODEARENA_H_
+#define _NODEARENA_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "MP1Node.h"
+
+/*
+ * Regions of the arena start on their own cache line
+ */
+#define ARENA_ALIGN 64
+
+/**
+ * STRUCT NAME: MemberSlot
+ *
+ * DESCRIPTION: A Member padded to whole cache lines, so that the flags at the head
+ * 				of every node's Member start a line of their own
+ */
+typedef struct alignas(ARENA_ALIGN) MemberSlot {
+	Member member;
+} MemberSlot;
+
+/**
+ * CLASS NAME: NodeArena
+ *
+ * DESCRIPTION: All the nodes of a run in one block, ordered by node index, in
+ * 				three regions walked in step by the tick loops:
+ * 				- the tick each node starts at, read for every node every tick;
+ * 				- the Members, whose flags are checked for every node every tick;
+ * 				- the MP1Nodes, with the protocol's larger state, only entered for
+ * 				  the nodes that run.
+ * 				Node i is at the same index in each region, so a loop over the
+ * 				nodes reads each region front to back instead of chasing pointers.
+ */
+class NodeArena {
+private:
+	char *block;
+	int count;
+	int *starts;
+	MemberSlot *members;
+	MP1Node *nodes;
+	NodeArena(const NodeArena &anotherArena);
+	NodeArena &operator=(const NodeArena &anotherArena);
+public:
+	NodeArena();
+	virtual ~NodeArena();
+	void create(Params *par, EmulNet *en, Log *log);
+	void destroy();
+	int size() const { return count; }
+	MP1Node *operator[](int i) const { return nodes + i; }
+	Member *member(int i) const { return &members[i].member; }
+	// tick at which node i is introduced into the group
+	int startAt(int i) const { return starts[i]; }
+};
+
+#endif /* _NODEARENA_H_ */
@@ -6,37 +6,313 @@
 
 #include "Params.h"
 
+/**
+ * FUNCTION NAME: setstring
+ *
+ * DESCRIPTION: Set a string parameter to the first word of value
+ */
+static void setstring(string &param, const char *value) {
+	char word[768];
+	if ( sscanf(value, "%767s", word) == 1 ) {
+		param = word;
+	}
+}
+
 /**
  * Constructor
  */
-Params::Params(): PORTNUM(8001) {}
+Params::Params(): MAX_NNB(0), SINGLE_FAILURE(0), MSG_DROP_PROB(0), DROP_MSG(0), TREMOVE(20), TFAIL(5),
+	SEED((unsigned int)time(NULL)), VERBOSE(1), OUTDIR(""), CHECKPOINT_AT(-1), EVENT_DRIVEN(0), PROTOCOL_PERIOD(1),
+	LINK_LATENCY(1), LINK_JITTER(0), JITTER_DIST(JITTER_UNIFORM), NODE_BANDWIDTH(0), NODE_QUEUE_TICKS(0),
+	GE_P_GOOD_BAD(0), GE_P_BAD_GOOD(1), GE_LOSS_GOOD(0), GE_LOSS_BAD(0),
+	MSG_TTL(100), DEAD_LETTER_TICKS(10), INBOX_CAPACITY(1024),
+	DIGEST_RANGES(16), DIGEST_BUCKET(8),
+	PARTIAL_VIEW(0), ACTIVE_VIEW(5), PASSIVE_VIEW(30), SHUFFLE_PERIOD(10), SHUFFLE_LENGTH(4),
+	PIGGYBACK_LAMBDA(3), PIGGYBACK_MAX(6), JOIN_RETRY(5), JOIN_RETRY_MAX(40),
+	TOMBSTONE_TTL(0), RECONNECT_PERIOD(0), EVENT_RING(256), RING_VNODES(16), PHASE_REPORT(100), PERF_COUNTERS(0), MEM_REPORT(0), MEM_GROWTH_REPORTS(3), PORTNUM(8001), randstate(SEED) {}
 
 /**
  * FUNCTION NAME: setparams
  *
  * DESCRIPTION: Set the parameters for this test case
+ * 				The file holds one "KEY: value" pair per line
  */
 void Params::setparams(char *config_file) {
 	FILE *fp = fopen(config_file,"r");
+	char line[1024];
+	char key[256];
+	char value[768];
 
-	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
-	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
-	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
-	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
+	if ( fp == NULL ) {
+		fprintf(stderr, "Unable to open configuration file %s\n", config_file);
+		exit(1);
+	}
+
+	while ( fgets(line, sizeof(line), fp) != NULL ) {
+		if ( sscanf(line, " %255[^: \t] : %767[^\n]", key, value) != 2 ) {
+			continue;
+		}
+		if ( !setparam(key, value) ) {
+			fprintf(stderr, "Unknown parameter %s in %s\n", key, config_file);
+		}
+	}
 
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
+	fclose(fp);
+	finalize();
+	return;
+}
+
+/**
+ * FUNCTION NAME: setparam
+ *
+ * DESCRIPTION: Set a single parameter from its textual value
+ *
+ * RETURNS:
+ * false if the key is unknown
+ */
+bool Params::setparam(const char *key, const char *value) {
+	if ( !strcmp(key, "MAX_NNB") ) {
+		MAX_NNB = atoi(value);
+	}
+	else if ( !strcmp(key, "SINGLE_FAILURE") ) {
+		SINGLE_FAILURE = atoi(value);
+	}
+	else if ( !strcmp(key, "DROP_MSG") ) {
+		DROP_MSG = atoi(value);
+	}
+	else if ( !strcmp(key, "MSG_DROP_PROB") ) {
+		MSG_DROP_PROB = atof(value);
+	}
+	else if ( !strcmp(key, "TFAIL") ) {
+		TFAIL = atoi(value);
+	}
+	else if ( !strcmp(key, "TREMOVE") ) {
+		TREMOVE = atoi(value);
+	}
+	else if ( !strcmp(key, "SEED") ) {
+		SEED = (unsigned int)strtoul(value, NULL, 10);
+	}
+	else if ( !strcmp(key, "VERBOSE") ) {
+		VERBOSE = atoi(value);
+	}
+	else if ( !strcmp(key, "OUTDIR") ) {
+		setstring(OUTDIR, value);
+	}
+	else if ( !strcmp(key, "CHECKPOINT_AT") ) {
+		CHECKPOINT_AT = atoi(value);
+	}
+	else if ( !strcmp(key, "CHECKPOINT_SAVE") ) {
+		setstring(CHECKPOINT_SAVE, value);
+	}
+	else if ( !strcmp(key, "CHECKPOINT_LOAD") ) {
+		setstring(CHECKPOINT_LOAD, value);
+	}
+	else if ( !strcmp(key, "EVENT_DRIVEN") ) {
+		EVENT_DRIVEN = atoi(value);
+	}
+	else if ( !strcmp(key, "PROTOCOL_PERIOD") ) {
+		PROTOCOL_PERIOD = atof(value);
+	}
+	else if ( !strcmp(key, "LINK_LATENCY") ) {
+		LINK_LATENCY = atof(value);
+	}
+	else if ( !strcmp(key, "LINK_JITTER") ) {
+		LINK_JITTER = atof(value);
+	}
+	else if ( !strcmp(key, "JITTER_DIST") ) {
+		if ( !strncmp(value, "normal", 6) ) {
+			JITTER_DIST = JITTER_NORMAL;
+		}
+		else if ( !strncmp(value, "exponential", 11) ) {
+			JITTER_DIST = JITTER_EXPONENTIAL;
+		}
+		else {
+			JITTER_DIST = JITTER_UNIFORM;
+		}
+	}
+	else if ( !strcmp(key, "LINK") ) {
+		// LINK: <from> <to> <latency> <jitter>
+		LinkSpec link;
+		if ( sscanf(value, "%d %d %lf %lf", &link.from, &link.to, &link.latency, &link.jitter) != 4 ) {
+			return false;
+		}
+		LINKS.push_back(link);
+	}
+	else if ( !strcmp(key, "NODE_BANDWIDTH") ) {
+		NODE_BANDWIDTH = atof(value);
+	}
+	else if ( !strcmp(key, "NODE_QUEUE_TICKS") ) {
+		NODE_QUEUE_TICKS = atof(value);
+	}
+	else if ( !strcmp(key, "GE_P_GOOD_BAD") ) {
+		GE_P_GOOD_BAD = atof(value);
+	}
+	else if ( !strcmp(key, "GE_P_BAD_GOOD") ) {
+		GE_P_BAD_GOOD = atof(value);
+	}
+	else if ( !strcmp(key, "GE_LOSS_GOOD") ) {
+		GE_LOSS_GOOD = atof(value);
+	}
+	else if ( !strcmp(key, "GE_LOSS_BAD") ) {
+		GE_LOSS_BAD = atof(value);
+	}
+	else if ( !strcmp(key, "MSG_TTL") ) {
+		MSG_TTL = atoi(value);
+	}
+	else if ( !strcmp(key, "DEAD_LETTER_TICKS") ) {
+		DEAD_LETTER_TICKS = atoi(value);
+	}
+	else if ( !strcmp(key, "INBOX_CAPACITY") ) {
+		INBOX_CAPACITY = atoi(value);
+	}
+	else if ( !strcmp(key, "DIGEST_RANGES") ) {
+		DIGEST_RANGES = atoi(value);
+	}
+	else if ( !strcmp(key, "DIGEST_BUCKET") ) {
+		DIGEST_BUCKET = atoi(value);
+	}
+	else if ( !strcmp(key, "PARTIAL_VIEW") ) {
+		PARTIAL_VIEW = atoi(value);
+	}
+	else if ( !strcmp(key, "ACTIVE_VIEW") ) {
+		ACTIVE_VIEW = atoi(value);
+	}
+	else if ( !strcmp(key, "PASSIVE_VIEW") ) {
+		PASSIVE_VIEW = atoi(value);
+	}
+	else if ( !strcmp(key, "SHUFFLE_PERIOD") ) {
+		SHUFFLE_PERIOD = atoi(value);
+	}
+	else if ( !strcmp(key, "SHUFFLE_LENGTH") ) {
+		SHUFFLE_LENGTH = atoi(value);
+	}
+	else if ( !strcmp(key, "PIGGYBACK_LAMBDA") ) {
+		PIGGYBACK_LAMBDA = atoi(value);
+	}
+	else if ( !strcmp(key, "PIGGYBACK_MAX") ) {
+		PIGGYBACK_MAX = atoi(value);
+	}
+	else if ( !strcmp(key, "INTRODUCER") ) {
+		// INTRODUCER: <id>, once per seed node
+		INTRODUCERS.push_back(atoi(value));
+	}
+	else if ( !strcmp(key, "JOIN_RETRY") ) {
+		JOIN_RETRY = atoi(value);
+	}
+	else if ( !strcmp(key, "JOIN_RETRY_MAX") ) {
+		JOIN_RETRY_MAX = atoi(value);
+	}
+	else if ( !strcmp(key, "TOMBSTONE_TTL") ) {
+		TOMBSTONE_TTL = atoi(value);
+	}
+	else if ( !strcmp(key, "RECONNECT_PERIOD") ) {
+		RECONNECT_PERIOD = atoi(value);
+	}
+	else if ( !strcmp(key, "EVENT_RING") ) {
+		EVENT_RING = atoi(value);
+	}
+	else if ( !strcmp(key, "RING_VNODES") ) {
+		RING_VNODES = atoi(value);
+	}
+	else if ( !strcmp(key, "TRACE_RECORD") ) {
+		setstring(TRACE_RECORD, value);
+	}
+	else if ( !strcmp(key, "TRACE_REPLAY") ) {
+		setstring(TRACE_REPLAY, value);
+	}
+	else if ( !strcmp(key, "PHASE_REPORT") ) {
+		PHASE_REPORT = atoi(value);
+	}
+	else if ( !strcmp(key, "PERF_COUNTERS") ) {
+		PERF_COUNTERS = atoi(value);
+	}
+	else if ( !strcmp(key, "MEM_REPORT") ) {
+		MEM_REPORT = atoi(value);
+	}
+	else if ( !strcmp(key, "MEM_GROWTH_REPORTS") ) {
+		MEM_GROWTH_REPORTS = atoi(value);
+	}
+	else if ( !strcmp(key, "SCENARIO") ) {
+		setstring(SCENARIO, value);
+	}
+	else if ( !strcmp(key, "REPLAY_NODE") ) {
+		// REPLAY_NODE: <id>, once per node fed by a replay
+		REPLAY_NODES.push_back(atoi(value));
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: finalize
+ *
+ * DESCRIPTION: Derive the dependent parameters once all keys have been set
+ */
+void Params::finalize() {
 	EN_GPSZ = MAX_NNB;
 	STEP_RATE=.25;
 	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
+	simtime = 0;
 	dropmsg = 0;
 	allNodesJoined = 0;
-	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
+	for ( int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
 	}
-	fclose(fp);
-	return;
+	randstate = SEED;
+	// a digest reply names the differing ranges in one 64-bit mask
+	DIGEST_RANGES = max(0, min(DIGEST_RANGES, 64));
+	DIGEST_BUCKET = max(1, DIGEST_BUCKET);
+	ACTIVE_VIEW = max(1, ACTIVE_VIEW);
+	PASSIVE_VIEW = max(0, PASSIVE_VIEW);
+	SHUFFLE_PERIOD = max(1, SHUFFLE_PERIOD);
+	// removals travel only as piggybacked updates, so at least one must fit; the count is one byte
+	PIGGYBACK_LAMBDA = max(1, PIGGYBACK_LAMBDA);
+	PIGGYBACK_MAX = max(1, min(PIGGYBACK_MAX, 255));
+	vector<int> seeds;
+	for ( unsigned int i = 0; i < INTRODUCERS.size(); i++ ) {
+		if ( INTRODUCERS[i] >= 1 && INTRODUCERS[i] <= EN_GPSZ && find(seeds.begin(), seeds.end(), INTRODUCERS[i]) == seeds.end() ) {
+			seeds.push_back(INTRODUCERS[i]);
+		}
+	}
+	if ( seeds.empty() ) {
+		seeds.push_back(1);
+	}
+	INTRODUCERS.swap(seeds);
+	JOIN_RETRY = max(1, JOIN_RETRY);
+	JOIN_RETRY_MAX = max(JOIN_RETRY, JOIN_RETRY_MAX);
+	TOMBSTONE_TTL = max(0, TOMBSTONE_TTL);
+	RECONNECT_PERIOD = max(0, RECONNECT_PERIOD);
+	EVENT_RING = max(2, EVENT_RING);
+	// the inbox rounds its capacity up to a power of two
+	INBOX_CAPACITY = max(2, min(INBOX_CAPACITY, 1 << 30));
+	RING_VNODES = max(0, RING_VNODES);
+	vector<int> replayed;
+	for ( unsigned int i = 0; i < REPLAY_NODES.size(); i++ ) {
+		if ( REPLAY_NODES[i] >= 1 && REPLAY_NODES[i] <= EN_GPSZ && find(replayed.begin(), replayed.end(), REPLAY_NODES[i]) == replayed.end() ) {
+			replayed.push_back(REPLAY_NODES[i]);
+		}
+	}
+	REPLAY_NODES.swap(replayed);
+	PHASE_REPORT = max(0, PHASE_REPORT);
+	MEM_REPORT = max(0, MEM_REPORT);
+	MEM_GROWTH_REPORTS = max(1, MEM_GROWTH_REPORTS);
+}
+
+/**
+ * FUNCTION NAME: outpath
+ *
+ * DESCRIPTION: Path of a log file inside this run's output directory
+ */
+string Params::outpath(const char *filename) {
+	if ( OUTDIR.empty() ) {
+		return string(filename);
+	}
+	return OUTDIR + "/" + filename;
 }
 
 /**
@@ -48,3 +324,32 @@ void Params::setparams(char *config_file) {
 int Params::getcurrtime(){
     return globaltime;
 }
+
+/**
+ * FUNCTION NAME: setsimtime
+ *
+ * DESCRIPTION: Advance the clock to units of TICK_UNITS
+ */
+void Params::setsimtime(long long units) {
+	simtime = units;
+	globaltime = (int)(units / TICK_UNITS);
+}
+
+/**
+ * FUNCTION NAME: nextrand
+ *
+ * DESCRIPTION: Next number of this run's random stream.
+ * 				Every run owns its stream so concurrent runs stay reproducible from their SEED.
+ */
+int Params::nextrand() {
+	return rand_r(&randstate);
+}
+
+/**
+ * FUNCTION NAME: nextuniform
+ *
+ * DESCRIPTION: Next number of this run's random stream, scaled to [0, 1)
+ */
+double Params::nextuniform() {
+	return rand_r(&randstate) / ((double)RAND_MAX + 1);
+}
@@ -11,6 +11,26 @@
 #include "Params.h"
 #include "Member.h"
 
+/*
+ * Macros
+ */
+// simulation time units per protocol tick
+#define TICK_UNITS 1000
+
+/**
+ * STRUCT NAME: LinkSpec
+ *
+ * DESCRIPTION: Latency override of the links between two nodes, 0 matches any node
+ */
+typedef struct LinkSpec {
+	int from;
+	int to;
+	double latency;
+	double jitter;
+} LinkSpec;
+
+enum JitterDist { JITTER_UNIFORM, JITTER_NORMAL, JITTER_EXPONENTIAL };
+
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
 /**
@@ -27,13 +47,75 @@ public:
 	int EN_GPSZ;			    // actual number of peers
 	int MAX_MSG_SIZE;
 	int DROP_MSG;
+	int TREMOVE;				// ticks of silence after which a member is suspected
+	int TFAIL;					// further ticks a suspected member gets before it is removed
+	unsigned int SEED;			// seed of this run's random number stream
+	int VERBOSE;				// print node introductions on stdout
+	string OUTDIR;				// directory the log files of this run are written to
+	int CHECKPOINT_AT;			// tick after which the simulation is checkpointed, -1 for never
+	string CHECKPOINT_SAVE;		// checkpoint file written at CHECKPOINT_AT
+	string CHECKPOINT_LOAD;		// checkpoint file the run resumes from
+	int EVENT_DRIVEN;			// run the discrete-event engine instead of the tick loop
+	double PROTOCOL_PERIOD;		// ticks between protocol rounds of a node in the event engine
+	double LINK_LATENCY;		// mean one-way link latency in ticks
+	double LINK_JITTER;			// spread of the latency in ticks
+	int JITTER_DIST;			// distribution of the jitter, a JitterDist
+	vector<LinkSpec> LINKS;		// per-link latency overrides
+	double NODE_BANDWIDTH;		// bytes a node can send per tick, 0 for unlimited
+	double NODE_QUEUE_TICKS;	// longest send backlog in ticks before tail drop, 0 for unlimited
+	double GE_P_GOOD_BAD;		// Gilbert-Elliott: per message chance a good link turns bad
+	double GE_P_BAD_GOOD;		// Gilbert-Elliott: per message chance a bad link recovers
+	double GE_LOSS_GOOD;		// Gilbert-Elliott: loss probability in the good state
+	double GE_LOSS_BAD;			// Gilbert-Elliott: loss probability in the bad state
+	int MSG_TTL;				// ticks after sending at which an undelivered message is reclaimed, 0 for never
+	int DEAD_LETTER_TICKS;		// ticks a due message may wait on a destination that stopped receiving, 0 for ever
+	int INBOX_CAPACITY;			// messages a node's inbox holds before senders are pushed back
+	int DIGEST_RANGES;			// id ranges in an anti-entropy digest, at most 64, 0 to gossip full lists
+	int DIGEST_BUCKET;			// heartbeats that hash alike in a digest
+	int PARTIAL_VIEW;			// 1 to keep only an active and a passive view instead of the full membership
+	int ACTIVE_VIEW;			// partial view: peers heartbeated and monitored directly
+	int PASSIVE_VIEW;			// partial view: known peers kept in reserve for the active view
+	int SHUFFLE_PERIOD;			// partial view: heartbeats between two view shuffles
+	int SHUFFLE_LENGTH;			// partial view: entries offered in a shuffle besides our own
+	int PIGGYBACK_LAMBDA;		// a membership update is piggybacked PIGGYBACK_LAMBDA * log2(N + 1) times
+	int PIGGYBACK_MAX;			// most membership updates piggybacked on one message
+	vector<int> INTRODUCERS;	// ids of the seed nodes that answer joins, the first one booting the group
+	int JOIN_RETRY;				// ticks before an unanswered join is retried, doubling on every retry
+	int JOIN_RETRY_MAX;			// longest wait between two join attempts
+	int TOMBSTONE_TTL;			// ticks a removed member stays tombstoned, 0 for ever
+	int RECONNECT_PERIOD;		// heartbeats between two probes of a tombstoned member, 0 for none
+	int EVENT_RING;				// membership events a node holds until they are polled
+	int RING_VNODES;			// virtual nodes per member on the consistent-hash ring, 0 for no ring
+	string TRACE_RECORD;		// trace file every send and receive of the run is recorded to
+	string TRACE_REPLAY;		// trace file whose deliveries are fed back instead of running the scenario
+	vector<int> REPLAY_NODES;	// ids of the nodes a replay feeds, every node if empty
+	int PHASE_REPORT;			// ticks between two phase timer reports, 0 to report at exit only
+	int PERF_COUNTERS;			// 1 to count cycles, instructions and cache and branch misses per phase
+	int MEM_REPORT;				// ticks between two memory reports per node, 0 for none
+	int MEM_GROWTH_REPORTS;		// reports in a row a node's memory must grow at to be flagged
+	string SCENARIO;			// failure and churn script run instead of the fixed failures
 	int dropmsg;
 	int globaltime;
+	long long simtime;			// current time in TICK_UNITS, globaltime is its whole ticks
 	int allNodesJoined;
 	short PORTNUM;
 	Params();
 	void setparams(char *);
+	bool setparam(const char *key, const char *value);
+	void finalize();
+	string outpath(const char *filename);
 	int getcurrtime();
+	void setsimtime(long long units);
+	int nextrand();
+	double nextuniform();
+	unsigned int getrandstate() {
+		return randstate;
+	}
+	void setrandstate(unsigned int state) {
+		randstate = state;
+	}
+private:
+	unsigned int randstate;
 };
 
 #endif /* _PARAMS_H_ */
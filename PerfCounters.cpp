@@ -0,0 +1,124 @@
+/**********************************
+ * FILE NAME: PerfCounters.cpp
+ *
+ * DESCRIPTION: Definition of the hardware performance counter group
+ **********************************/
+
+#include "PerfCounters.h"
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/**
+ * Constructor
+ */
+PerfCounters::PerfCounters(): leader(-1), opened(0), error(0) {
+	for ( int i = 0; i < PERF_EVENTS; i++ ) {
+		fds[i] = -1;
+		slot[i] = -1;
+	}
+}
+
+/**
+ * Destructor
+ */
+PerfCounters::~PerfCounters() {
+	close();
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Open the counters of the calling thread and start them. The first
+ * 				event that opens leads the group.
+ *
+ * RETURNS:
+ * SUCCESS if at least one counter is available
+ */
+int PerfCounters::open() {
+	static const unsigned long long config[PERF_EVENTS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	close();
+	for ( int i = 0; i < PERF_EVENTS; i++ ) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = leader < 0 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+		if ( fds[i] < 0 ) {
+			if ( error == 0 ) {
+				error = errno;
+			}
+			continue;
+		}
+		if ( leader < 0 ) {
+			leader = fds[i];
+		}
+		slot[i] = opened++;
+	}
+	if ( leader < 0 ) {
+		return FAILURE;
+	}
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Release the counters
+ */
+void PerfCounters::close() {
+	for ( int i = PERF_EVENTS - 1; i >= 0; i-- ) {
+		if ( fds[i] >= 0 ) {
+			::close(fds[i]);
+		}
+		fds[i] = -1;
+		slot[i] = -1;
+	}
+	leader = -1;
+	opened = 0;
+	error = 0;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Current value of every counter, 0 for those not counted
+ */
+void PerfCounters::read(PerfReading *out) {
+	// PERF_FORMAT_GROUP: {nr, value[nr]}
+	unsigned long long buf[1 + PERF_EVENTS];
+
+	memset(out, 0, sizeof(PerfReading));
+	if ( leader < 0 || ::read(leader, buf, sizeof(buf)) < (ssize_t)sizeof(unsigned long long) ) {
+		return;
+	}
+	for ( int i = 0; i < PERF_EVENTS; i++ ) {
+		if ( slot[i] >= 0 && (unsigned long long)slot[i] < buf[0] ) {
+			out->value[i] = buf[1 + slot[i]];
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: name
+ *
+ * DESCRIPTION: Name of an event in the report
+ */
+const char *PerfCounters::name(PerfEvent event) {
+	static const char *names[PERF_EVENTS] = { "cycles", "instructions", "llc-misses", "branch-misses" };
+	return names[event];
+}
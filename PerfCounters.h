@@ -0,0 +1,65 @@
+/**********************************
+ * FILE NAME: PerfCounters.h
+ *
+ * DESCRIPTION: Header file of the hardware performance counter group
+ **********************************/
+
+#ifndef _PERFCOUNTERS_H_
+#define _PERFCOUNTERS_H_
+
+#include "stdincludes.h"
+
+/**
+ * Hardware events counted, in the order of a reading
+ */
+enum PerfEvent {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_EVENTS
+};
+
+/**
+ * STRUCT NAME: PerfReading
+ *
+ * DESCRIPTION: Counter values, or their difference between two readings
+ */
+typedef struct PerfReading {
+	unsigned long long value[PERF_EVENTS];
+} PerfReading;
+
+/**
+ * CLASS NAME: PerfCounters
+ *
+ * DESCRIPTION: User-space cycles, instructions, last level cache misses and
+ * 				branch misses of the calling thread, opened with perf_event_open
+ * 				as one group so that a single read returns all of them. Events
+ * 				the CPU or the kernel doesn't offer read as 0; if none can be
+ * 				opened, for instance when a container forbids perf_event_open,
+ * 				the group is unavailable and reads nothing.
+ */
+class PerfCounters {
+private:
+	int fds[PERF_EVENTS];
+	// position of each open event in a group read, -1 if it isn't open
+	int slot[PERF_EVENTS];
+	int leader;
+	int opened;
+	int error;
+	PerfCounters(const PerfCounters &anotherCounters);
+	PerfCounters &operator=(const PerfCounters &anotherCounters);
+public:
+	PerfCounters();
+	virtual ~PerfCounters();
+	int open();
+	void close();
+	bool available() const { return opened > 0; }
+	bool counts(PerfEvent event) const { return slot[event] >= 0; }
+	// errno of the first event that could not be opened, 0 if all were
+	int lastError() const { return error; }
+	void read(PerfReading *out);
+	static const char *name(PerfEvent event);
+};
+
+#endif /* _PERFCOUNTERS_H_ */
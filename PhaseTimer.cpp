@@ -0,0 +1,183 @@
+/**********************************
+ * FILE NAME: PhaseTimer.cpp
+ *
+ * DESCRIPTION: Definition of the phase latency histograms, counters and their report
+ **********************************/
+
+#include "PhaseTimer.h"
+#include "Log.h"
+
+/**
+ * FUNCTION NAME: bucket
+ *
+ * DESCRIPTION: Bucket of a value: the value itself below 2^(SUB_BITS+1), otherwise
+ * 				its power of two and its next SUB_BITS bits
+ */
+int Histogram::bucket(unsigned long long value) {
+	if ( value < (2ULL << HISTOGRAM_SUB_BITS) ) {
+		return (int)value;
+	}
+	int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+	return (shift << HISTOGRAM_SUB_BITS) + (int)(value >> shift);
+}
+
+/**
+ * FUNCTION NAME: highest
+ *
+ * DESCRIPTION: Largest value falling in a bucket
+ */
+unsigned long long Histogram::highest(int bucket) {
+	if ( bucket < (2 << HISTOGRAM_SUB_BITS) ) {
+		return bucket;
+	}
+	int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+	unsigned long long top = (bucket & ((1 << HISTOGRAM_SUB_BITS) - 1)) + (1ULL << HISTOGRAM_SUB_BITS);
+	return (top << shift) + (1ULL << shift) - 1;
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Forget every value
+ */
+void Histogram::reset() {
+	memset(counts, 0, sizeof(counts));
+	n = 0;
+	sum = 0;
+	largest = 0;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Add the values of another histogram to this one
+ */
+void Histogram::add(const Histogram &other) {
+	for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ ) {
+		counts[i] += other.counts[i];
+	}
+	n += other.n;
+	sum += other.sum;
+	largest = max(largest, other.largest);
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Value below which a fraction q of the values fall, rounded up to its
+ * 				bucket's highest value and capped at the largest value recorded
+ */
+unsigned long long Histogram::percentile(double q) const {
+	unsigned long long rank = (unsigned long long)ceil(q * n), seen = 0;
+	if ( n == 0 ) {
+		return 0;
+	}
+	rank = max(rank, 1ULL);
+	for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ ) {
+		seen += counts[i];
+		if ( seen >= rank ) {
+			return min(highest(i), largest);
+		}
+	}
+	return largest;
+}
+
+/**
+ * FUNCTION NAME: current
+ *
+ * DESCRIPTION: Profile of the calling thread
+ */
+PhaseProfile &PhaseProfile::current() {
+	static thread_local PhaseProfile profile;
+	return profile;
+}
+
+/**
+ * FUNCTION NAME: name
+ *
+ * DESCRIPTION: Name of a phase in the report
+ */
+const char *PhaseProfile::name(Phase phase) {
+	static const char *names[PHASE_COUNT] = {
+		"tick", "recvLoop", "ENrecv", "checkMessages", "nodeLoopOps", "merge", "serialize", "log"
+	};
+	return names[phase];
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Start a new run, with the hardware counters of this thread if counters is set
+ */
+void PhaseProfile::reset(bool counters) {
+	for ( int i = 0; i < PHASE_COUNT; i++ ) {
+		interval[i].reset();
+		overall[i].reset();
+	}
+	memset(perfInterval, 0, sizeof(perfInterval));
+	memset(perfOverall, 0, sizeof(perfOverall));
+	intervalStart = 0;
+	perfWanted = counters;
+	perf.close();
+	if ( counters ) {
+		perf.open();
+	}
+}
+
+/**
+ * FUNCTION NAME: reportPerf
+ *
+ * DESCRIPTION: Write a phase's counters, per call: a call of checkMessages being one
+ * 				node's batch of messages, and so on
+ */
+void PhaseProfile::reportPerf(Log *log, Address *addr, Phase phase, const PerfReading &sum, unsigned long long calls, int from, int now) {
+	char line[512];
+	int len = snprintf(line, sizeof(line), "#STATSLOG# perf %s ticks %d-%d: %llu calls, per call", name(phase), from, now, calls);
+	for ( int e = 0; e < PERF_EVENTS && len < (int)sizeof(line); e++ ) {
+		if ( perf.counts((PerfEvent)e) ) {
+			len += snprintf(line + len, sizeof(line) - len, " %.1f %s", (double)sum.value[e] / calls, PerfCounters::name((PerfEvent)e));
+		}
+	}
+	if ( perf.counts(PERF_CYCLES) && perf.counts(PERF_INSTRUCTIONS) && sum.value[PERF_CYCLES] > 0 && len < (int)sizeof(line) ) {
+		snprintf(line + len, sizeof(line) - len, " IPC %.2f", (double)sum.value[PERF_INSTRUCTIONS] / sum.value[PERF_CYCLES]);
+	}
+	log->LOG(addr, "%s", line);
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Write the phases timed since the last report to stats.log and start
+ * 				a new interval; the final report covers the whole run instead
+ */
+void PhaseProfile::report(Log *log, Address *addr, int now, bool final) {
+	Histogram h[PHASE_COUNT];
+	PerfReading counters[PHASE_COUNT];
+	for ( int i = 0; i < PHASE_COUNT; i++ ) {
+		overall[i].add(interval[i]);
+		h[i] = final ? overall[i] : interval[i];
+		interval[i].reset();
+		for ( int e = 0; e < PERF_EVENTS; e++ ) {
+			perfOverall[i].value[e] += perfInterval[i].value[e];
+		}
+		counters[i] = final ? perfOverall[i] : perfInterval[i];
+	}
+	memset(perfInterval, 0, sizeof(perfInterval));
+	int from = final ? 0 : intervalStart;
+	intervalStart = now;
+	// logging is itself a phase, so only log once the histograms are taken
+	for ( int i = 0; i < PHASE_COUNT; i++ ) {
+		if ( h[i].count() == 0 ) {
+			continue;
+		}
+		log->LOG(addr, "#STATSLOG# phase %s ticks %d-%d: %llu samples %.3f ms p50 %.2f us p90 %.2f us p99 %.2f us max %.2f us",
+				name((Phase)i), from, now, h[i].count(), h[i].total() / 1e6, h[i].percentile(0.5) / 1e3,
+				h[i].percentile(0.9) / 1e3, h[i].percentile(0.99) / 1e3, h[i].maximum() / 1e3);
+		if ( perf.available() ) {
+			this->reportPerf(log, addr, (Phase)i, counters[i], h[i].count(), from, now);
+		}
+	}
+	if ( final && perfWanted && !perf.available() ) {
+		log->LOG(addr, "#STATSLOG# perf counters unavailable: %s", strerror(perf.lastError()));
+	}
+}
@@ -0,0 +1,148 @@
+/**********************************
+ * FILE NAME: PhaseTimer.h
+ *
+ * DESCRIPTION: Header file of the simulation phase timers, their latency histograms
+ * 				and hardware counters.
+ * 				The timers are only compiled in with make PHASE_TIMERS=1.
+ **********************************/
+
+#ifndef _PHASETIMER_H_
+#define _PHASETIMER_H_
+
+#include "stdincludes.h"
+#include "PerfCounters.h"
+
+class Log;
+class Address;
+
+/*
+ * Macros
+ */
+// sub-buckets per power of two, i.e. about 6% precision
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BITS) << HISTOGRAM_SUB_BITS)
+
+#ifdef PHASE_TIMERS
+#define PHASE_TIMER_NAME2(line) phaseTimer##line
+#define PHASE_TIMER_NAME(line) PHASE_TIMER_NAME2(line)
+// time the rest of the enclosing scope as phase
+#define PHASE_TIMER(phase) PhaseTimer PHASE_TIMER_NAME(__LINE__)(phase)
+#else
+#define PHASE_TIMER(phase)
+#endif
+
+/**
+ * Timed phases of a simulation
+ */
+enum Phase {
+	PHASE_TICK,
+	PHASE_RECV_LOOP,
+	PHASE_EN_RECV,
+	PHASE_CHECK_MESSAGES,
+	PHASE_NODE_LOOP_OPS,
+	PHASE_MERGE,
+	PHASE_SERIALIZE,
+	PHASE_LOG,
+	PHASE_COUNT
+};
+
+/**
+ * CLASS NAME: Histogram
+ *
+ * DESCRIPTION: HDR-style histogram of durations in nanoseconds. Values below
+ * 				2^(SUB_BITS+1) have a bucket each; above, every power of two is
+ * 				split into 2^SUB_BITS buckets, so the relative error is bounded
+ * 				over the whole range and recording is a single increment.
+ */
+class Histogram {
+private:
+	unsigned long long counts[HISTOGRAM_BUCKETS];
+	unsigned long long n;
+	unsigned long long sum;
+	unsigned long long largest;
+	static int bucket(unsigned long long value);
+	static unsigned long long highest(int bucket);
+public:
+	Histogram() { reset(); }
+	void record(unsigned long long value) {
+		counts[bucket(value)]++;
+		n++;
+		sum += value;
+		largest = max(largest, value);
+	}
+	void reset();
+	void add(const Histogram &other);
+	unsigned long long count() const { return n; }
+	unsigned long long total() const { return sum; }
+	unsigned long long maximum() const { return largest; }
+	unsigned long long percentile(double q) const;
+};
+
+/**
+ * CLASS NAME: PhaseProfile
+ *
+ * DESCRIPTION: Histograms of every phase since the last report and since the
+ * 				start, and optionally the hardware counter totals of every phase.
+ * 				There is one profile per thread, so the runs of a sweep don't mix.
+ */
+class PhaseProfile {
+private:
+	Histogram interval[PHASE_COUNT];
+	Histogram overall[PHASE_COUNT];
+	PerfCounters perf;
+	bool perfWanted;
+	PerfReading perfInterval[PHASE_COUNT];
+	PerfReading perfOverall[PHASE_COUNT];
+	int intervalStart;
+	void reportPerf(Log *log, Address *addr, Phase phase, const PerfReading &sum, unsigned long long calls, int from, int now);
+public:
+	static PhaseProfile &current();
+	static const char *name(Phase phase);
+	PhaseProfile(): perfWanted(false), intervalStart(0) {}
+	void record(Phase phase, unsigned long long ns) {
+		interval[phase].record(ns);
+	}
+	bool counting() const { return perf.available(); }
+	void readCounters(PerfReading *out) { perf.read(out); }
+	void recordCounters(Phase phase, const PerfReading &start, const PerfReading &end) {
+		for ( int i = 0; i < PERF_EVENTS; i++ ) {
+			perfInterval[phase].value[i] += end.value[i] - start.value[i];
+		}
+	}
+	void reset(bool counters);
+	void report(Log *log, Address *addr, int now, bool final);
+};
+
+/**
+ * CLASS NAME: PhaseTimer
+ *
+ * DESCRIPTION: Records the time from its construction to its destruction in its
+ * 				phase's histogram, and the counters over it when they are on.
+ * 				Use it through PHASE_TIMER so that it compiles out.
+ */
+class PhaseTimer {
+private:
+	Phase phase;
+	PhaseProfile &profile;
+	struct timespec start;
+	PerfReading counters;
+public:
+	explicit PhaseTimer(Phase phase): phase(phase), profile(PhaseProfile::current()) {
+		if ( profile.counting() ) {
+			profile.readCounters(&counters);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+	}
+	~PhaseTimer() {
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		profile.record(phase, (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec);
+		if ( profile.counting() ) {
+			PerfReading now;
+			profile.readCounters(&now);
+			profile.recordCounters(phase, counters, now);
+		}
+	}
+};
+
+#endif /* _PHASETIMER_H_ */
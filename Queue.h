@@ -1,7 +1,7 @@
 /**********************************
  * FILE NAME: Queue.h
  *
- * DESCRIPTION: Header file for std::<queue> related functions
+ * DESCRIPTION: Header file for the per-node message inbox
  **********************************/
 
 #ifndef QUEUE_H_
@@ -9,21 +9,120 @@
 
 #include "stdincludes.h"
 #include "Member.h"
+#include <atomic>
 
 /**
  * Class name: Queue
  *
- * Description: This function wraps std::queue related functions
+ * Description: This function wraps the inbox related functions
  */
 class Queue {
 public:
 	Queue() {}
 	virtual ~Queue() {}
-	static bool enqueue(queue<q_elt> *queue, void *buffer, int size) {
-		q_elt element(buffer, size);
-		queue->emplace(element);
+	static bool enqueue(RingQueue<q_elt> *queue, void *buffer, int size) {
+		queue->push(q_elt(buffer, size));
 		return true;
 	}
 };
 
+/**
+ * Class name: MpscQueue
+ *
+ * Description: Bounded lock-free queue for many producers and a single consumer.
+ * 				Each slot carries a sequence number telling whose turn it is:
+ * 				a producer claims a slot by advancing tail with a CAS and
+ * 				publishes it by bumping the slot's sequence, the consumer reads
+ * 				slots in order and hands them back a lap later. push fails
+ * 				instead of blocking when the queue is full.
+ */
+template <typename T>
+class MpscQueue {
+private:
+	struct Cell {
+		atomic<unsigned int> seq;
+		T data;
+	};
+	Cell *cells;
+	unsigned int mask;
+	// keep the producers' and the consumer's cursors on different cache lines
+	char pad0[64];
+	atomic<unsigned int> tail;
+	char pad1[64];
+	// written by the consumer only, read by producers through size()
+	atomic<unsigned int> head;
+	MpscQueue(const MpscQueue &);
+	MpscQueue &operator = (const MpscQueue &);
+public:
+	explicit MpscQueue(unsigned int capacity) {
+		unsigned int c = 2;
+		while (c < capacity) {
+			c <<= 1;
+		}
+		cells = new Cell[c];
+		mask = c - 1;
+		for (unsigned int i = 0; i < c; i++) {
+			cells[i].seq.store(i, memory_order_relaxed);
+		}
+		tail.store(0, memory_order_relaxed);
+		head.store(0, memory_order_relaxed);
+	}
+	~MpscQueue() { delete[] cells; }
+	unsigned int capacity() const { return mask + 1; }
+	/**
+	 * Exact for the consumer, a snapshot for anyone else. head is read first: tail
+	 * only grows, so it can't be behind it, while a stale head read after tail could
+	 * pass it and wrap the difference. Pops between the loads can still make the
+	 * snapshot look fuller than the queue can be, hence the clamp.
+	 */
+	unsigned int size() const {
+		unsigned int h = head.load(memory_order_acquire);
+		unsigned int t = tail.load(memory_order_acquire);
+		return min(t - h, capacity());
+	}
+	/**
+	 * Append e, from any thread. Returns false if the queue is full
+	 */
+	bool push(const T &e) {
+		unsigned int pos = tail.load(memory_order_relaxed);
+		Cell *cell;
+		for (;;) {
+			cell = &cells[pos & mask];
+			int diff = (int)(cell->seq.load(memory_order_acquire) - pos);
+			if (diff == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = tail.load(memory_order_relaxed);
+			}
+		}
+		cell->data = e;
+		cell->seq.store(pos + 1, memory_order_release);
+		return true;
+	}
+	/**
+	 * Take the oldest element, consumer only. Returns false if nothing is published yet
+	 */
+	bool pop(T *out) {
+		unsigned int pos = head.load(memory_order_relaxed);
+		Cell *cell = &cells[pos & mask];
+		if ((int)(cell->seq.load(memory_order_acquire) - (pos + 1)) < 0) {
+			return false;
+		}
+		*out = cell->data;
+		cell->seq.store(pos + mask + 1, memory_order_release);
+		head.store(pos + 1, memory_order_release);
+		return true;
+	}
+	/**
+	 * i-th waiting element without taking it, only while no producer is running
+	 */
+	const T &at(unsigned int i) const { return cells[(head.load(memory_order_relaxed) + i) & mask].data; }
+};
+
 #endif /* QUEUE_H_ */
@@ -0,0 +1,99 @@
+/**********************************
+ * FILE NAME: Ring.cpp
+ *
+ * DESCRIPTION: Definition of the consistent-hash ring
+ **********************************/
+
+#include "Ring.h"
+#include <climits>
+
+/**
+ * FUNCTION NAME: mix
+ *
+ * DESCRIPTION: splitmix64 finalizer, spreading nearby inputs over the whole circle
+ */
+static unsigned long long mix(unsigned long long x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * FUNCTION NAME: point
+ *
+ * DESCRIPTION: Position of a member's replica-th virtual node
+ */
+unsigned long long HashRing::point(MemberKey member, int replica) {
+	return mix(mix((unsigned long long)member) + replica);
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Place a member's virtual nodes, O(vnodes * log N). Adding a member twice changes nothing.
+ */
+void HashRing::add(MemberKey member) {
+	for ( int i = 0; i < vnodes; i++ ) {
+		points.insert(make_pair(point(member, i), member));
+	}
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Take a member's virtual nodes off the ring, O(vnodes * log N)
+ */
+void HashRing::remove(MemberKey member) {
+	for ( int i = 0; i < vnodes; i++ ) {
+		points.erase(make_pair(point(member, i), member));
+	}
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Whether a member's virtual nodes are on the ring
+ */
+bool HashRing::contains(MemberKey member) const {
+	return vnodes > 0 && points.count(make_pair(point(member, 0), member)) > 0;
+}
+
+/**
+ * FUNCTION NAME: owners
+ *
+ * DESCRIPTION: The first replicas distinct members clockwise from the key's position,
+ * 				the primary owner first
+ *
+ * RETURNS:
+ * number of owners written to out, fewer than replicas if the ring holds fewer members
+ */
+int HashRing::owners(unsigned long long key, int replicas, vector<MemberKey> &out) const {
+	out.clear();
+	if ( points.empty() || replicas <= 0 ) {
+		return 0;
+	}
+	set<pair<unsigned long long, MemberKey>>::const_iterator it = points.lower_bound(make_pair(mix(key), (MemberKey)LLONG_MIN));
+	for ( unsigned int seen = 0; seen < points.size() && (int)out.size() < replicas; seen++, it++ ) {
+		if ( it == points.end() ) {
+			it = points.begin();
+		}
+		if ( find(out.begin(), out.end(), it->second) == out.end() ) {
+			out.push_back(it->second);
+		}
+	}
+	return out.size();
+}
+
+/**
+ * FUNCTION NAME: hashKey
+ *
+ * DESCRIPTION: 64-bit FNV-1a hash of an application key, for owners
+ */
+unsigned long long HashRing::hashKey(const char *key, size_t len) {
+	unsigned long long h = 0xcbf29ce484222325ULL;
+	for ( size_t i = 0; i < len; i++ ) {
+		h = (h ^ (unsigned char)key[i]) * 0x100000001b3ULL;
+	}
+	return h;
+}
@@ -0,0 +1,38 @@
+/**********************************
+ * FILE NAME: Ring.h
+ *
+ * DESCRIPTION: Header file of the consistent-hash ring built from the membership view
+ **********************************/
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: HashRing
+ *
+ * DESCRIPTION: Consistent-hash ring with a fixed number of virtual nodes per member
+ * 				on a 64-bit circle. Points are ordered by (position, member), so
+ * 				every node that holds the same members builds the same ring,
+ * 				whatever order it learned them in. A join or a removal touches
+ * 				only that member's points.
+ */
+class HashRing {
+private:
+	set<pair<unsigned long long, MemberKey>> points;
+	int vnodes;
+	static unsigned long long point(MemberKey member, int replica);
+public:
+	explicit HashRing(int vnodes) : vnodes(vnodes) {}
+	void add(MemberKey member);
+	void remove(MemberKey member);
+	bool contains(MemberKey member) const;
+	void clear() { points.clear(); }
+	int size() const { return vnodes > 0 ? points.size() / vnodes : 0; }
+	int owners(unsigned long long key, int replicas, vector<MemberKey> &out) const;
+	static unsigned long long hashKey(const char *key, size_t len);
+};
+
+#endif /* _RING_H_ */
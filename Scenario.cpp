@@ -0,0 +1,336 @@
+/**********************************
+ * FILE NAME: Scenario.cpp
+ *
+ * DESCRIPTION: Definition of the scripted failure and churn scenarios
+ **********************************/
+
+#include "Scenario.h"
+
+/**
+ * Constructor
+ */
+Scenario::Scenario(): next(0), loaded(false) {}
+
+/*
+ * A new event of the given type, with nothing else set
+ */
+static ScenarioEvent makeEvent(int at, enum ScenarioEventType type, int node) {
+	ScenarioEvent e;
+	e.at = at;
+	e.type = type;
+	e.node = node;
+	e.rackSize = 0;
+	e.downtime = 0;
+	e.prob = 0;
+	e.cut = 0;
+	e.oneway = false;
+	return e;
+}
+
+/*
+ * Order of an event's tick among the events, for upper_bound
+ */
+static bool dueBefore(int at, const ScenarioEvent &e) {
+	return at < e.at;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Read a scenario for a group of the given number of nodes
+ *
+ * RETURNS:
+ * SUCCESS, or FAILURE after saying on stderr which line is wrong
+ */
+int Scenario::load(const char *path, int nodes) {
+	FILE *fp = fopen(path, "r");
+	char line[1024];
+	char action[32];
+	char args[768];
+	int at, number = 0;
+
+	if ( fp == NULL ) {
+		fprintf(stderr, "Unable to open scenario file %s\n", path);
+		return FAILURE;
+	}
+	events.clear();
+	sides.clear();
+	next = 0;
+	while ( fgets(line, sizeof(line), fp) != NULL ) {
+		number++;
+		char *comment = strchr(line, '#');
+		if ( comment != NULL ) {
+			*comment = 0;
+		}
+		if ( strspn(line, " \t\r\n") == strlen(line) ) {
+			continue;
+		}
+		args[0] = 0;
+		if ( sscanf(line, " %d : %31s %767[^\n]", &at, action, args) < 2 || at < 0 || !parseStep(at, action, args, nodes) ) {
+			fprintf(stderr, "Bad scenario step at %s:%d\n", path, number);
+			fclose(fp);
+			return FAILURE;
+		}
+	}
+	fclose(fp);
+	loaded = true;
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: parseIds
+ *
+ * DESCRIPTION: Read a list of ids and ranges such as 3,5,10-19, each between 1 and limit,
+ * 				or "random <n>", which gives n zeros
+ *
+ * RETURNS:
+ * the number of characters read, 0 if the list is malformed
+ */
+int Scenario::parseIds(const char *spec, int limit, vector<int> &ids) {
+	int n, from, to, len;
+	ids.clear();
+	if ( sscanf(spec, " random %d%n", &n, &len) == 1 ) {
+		if ( n < 0 ) {
+			return 0;
+		}
+		ids.assign(n, 0);
+		return len;
+	}
+	int pos = 0;
+	for ( ;; ) {
+		if ( sscanf(spec + pos, " %d%n", &from, &len) != 1 ) {
+			return 0;
+		}
+		pos += len;
+		to = from;
+		if ( spec[pos] == '-' ) {
+			if ( sscanf(spec + pos + 1, "%d%n", &to, &len) != 1 ) {
+				return 0;
+			}
+			pos += len + 1;
+		}
+		if ( from < 1 || to > limit || from > to ) {
+			return 0;
+		}
+		for ( int id = from; id <= to; id++ ) {
+			ids.push_back(id);
+		}
+		if ( spec[pos] != ',' ) {
+			return pos;
+		}
+		pos++;
+	}
+}
+
+/**
+ * FUNCTION NAME: parseStep
+ *
+ * DESCRIPTION: Expand one step of the file into events
+ *
+ * RETURNS:
+ * false if the step is malformed
+ */
+bool Scenario::parseStep(int at, const char *action, const char *args, int nodes) {
+	vector<int> ids;
+	int used, downtime = 0, until, every, size;
+	double rate;
+	char rest[8];
+
+	if ( !strcmp(action, "crash") || !strcmp(action, "restart") ) {
+		bool crash = !strcmp(action, "crash");
+		if ( (used = parseIds(args, nodes, ids)) == 0 ) {
+			return false;
+		}
+		int extra = crash ? sscanf(args + used, "%d %7s", &downtime, rest) : sscanf(args + used, "%7s", rest);
+		// only crashes can pick at random
+		if ( extra > (crash ? 1 : 0) || downtime < 0 || (!crash && find(ids.begin(), ids.end(), 0) != ids.end()) ) {
+			return false;
+		}
+		for ( unsigned int i = 0; i < ids.size(); i++ ) {
+			ScenarioEvent e = makeEvent(at, crash ? SCN_CRASH : SCN_RESTART, ids[i]);
+			e.downtime = downtime;
+			schedule(e);
+		}
+		return true;
+	}
+	if ( !strcmp(action, "churn") ) {
+		int fields = sscanf(args, "%lf %d %d %7s", &rate, &until, &downtime, rest);
+		if ( fields < 2 || fields > 3 || rate < 0 || until < at || downtime < 0 ) {
+			return false;
+		}
+		// crash floor(rate * elapsed ticks) nodes in all, spread evenly over the ticks
+		for ( int t = at; t < until; t++ ) {
+			int crashes = (int)floor(rate * (t - at + 1)) - (int)floor(rate * (t - at));
+			for ( int k = 0; k < crashes; k++ ) {
+				ScenarioEvent e = makeEvent(t, SCN_CRASH, 0);
+				e.downtime = downtime;
+				schedule(e);
+			}
+		}
+		return true;
+	}
+	if ( !strcmp(action, "rolling") ) {
+		if ( (used = parseIds(args, nodes, ids)) == 0 || sscanf(args + used, "%d %d %7s", &every, &downtime, rest) != 2
+				|| every < 0 || downtime < 1 ) {
+			return false;
+		}
+		for ( unsigned int i = 0; i < ids.size(); i++ ) {
+			ScenarioEvent e = makeEvent(at + i * every, SCN_CRASH, ids[i]);
+			e.downtime = downtime;
+			schedule(e);
+		}
+		return true;
+	}
+	if ( !strcmp(action, "rack") ) {
+		if ( sscanf(args, "%d%n", &size, &used) != 1 || size < 1 ) {
+			return false;
+		}
+		int racks = (nodes + size - 1) / size;
+		int more = parseIds(args + used, racks, ids);
+		if ( more == 0 ) {
+			return false;
+		}
+		used += more;
+		if ( sscanf(args + used, "%d %7s", &downtime, rest) > 1 || downtime < 0 ) {
+			return false;
+		}
+		for ( unsigned int i = 0; i < ids.size(); i++ ) {
+			ScenarioEvent e = makeEvent(at, SCN_RACK, ids[i]);
+			e.rackSize = size;
+			e.downtime = downtime;
+			schedule(e);
+		}
+		return true;
+	}
+	if ( !strcmp(action, "drop") ) {
+		ScenarioEvent e = makeEvent(at, SCN_DROP, 0);
+		if ( sscanf(args, "%lf %7s", &e.prob, rest) != 1 || e.prob < 0 || e.prob > 1 ) {
+			return false;
+		}
+		schedule(e);
+		return true;
+	}
+	if ( !strcmp(action, "partition") ) {
+		vector<int> other;
+		int more;
+		// the first side, then an optional second one, the rest of the group if left out
+		if ( (used = parseIds(args, nodes, ids)) == 0 || find(ids.begin(), ids.end(), 0) != ids.end() ) {
+			return false;
+		}
+		if ( (more = parseIds(args + used, nodes, other)) > 0 ) {
+			used += more;
+		}
+		ScenarioEvent e = makeEvent(at, SCN_PARTITION, 0);
+		char word[8];
+		int fields = sscanf(args + used, "%7s %7s", word, rest);
+		if ( fields == 1 && !strcmp(word, "oneway") ) {
+			e.oneway = true;
+		}
+		else if ( fields > 0 ) {
+			return false;
+		}
+		for ( unsigned int i = 0; i < other.size(); i++ ) {
+			if ( other[i] == 0 || find(ids.begin(), ids.end(), other[i]) != ids.end() ) {
+				return false;
+			}
+		}
+		e.cut = sides.size() / 2;
+		sides.push_back(ids);
+		sides.push_back(other);
+		schedule(e);
+		return true;
+	}
+	if ( !strcmp(action, "heal") ) {
+		if ( sscanf(args, "%7s", rest) == 1 ) {
+			return false;
+		}
+		schedule(makeEvent(at, SCN_HEAL, 0));
+		return true;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Add an event after those already due at its tick
+ */
+void Scenario::schedule(const ScenarioEvent &e) {
+	events.insert(upper_bound(events.begin() + next, events.end(), e.at, dueBefore), e);
+}
+
+/**
+ * FUNCTION NAME: take
+ *
+ * DESCRIPTION: Move the events due by tick now into due, in order
+ *
+ * RETURNS:
+ * the number of events taken
+ */
+int Scenario::take(int now, vector<ScenarioEvent> &due) {
+	due.clear();
+	while ( next < events.size() && events[next].at <= now ) {
+		due.push_back(events[next++]);
+	}
+	// reclaim the taken events once they make up most of the vector
+	if ( next > 64 && next * 2 > events.size() ) {
+		events.erase(events.begin(), events.begin() + next);
+		next = 0;
+	}
+	return due.size();
+}
+
+/**
+ * FUNCTION NAME: nextTick
+ *
+ * DESCRIPTION: Tick of the next event, -1 when none is left
+ */
+int Scenario::nextTick() const {
+	return next < events.size() ? events[next].at : -1;
+}
+
+/**
+ * FUNCTION NAME: checkpoint
+ *
+ * DESCRIPTION: Save the events not taken yet, including pending restarts
+ */
+void Scenario::checkpoint(CheckpointWriter *w) {
+	w->put<bool>(loaded);
+	w->put<int>(events.size() - next);
+	for ( unsigned int i = next; i < events.size(); i++ ) {
+		w->put<ScenarioEvent>(events[i]);
+	}
+	w->put<int>(sides.size());
+	for ( unsigned int i = 0; i < sides.size(); i++ ) {
+		w->put<int>(sides[i].size());
+		w->putBytes(sides[i].data(), sides[i].size() * sizeof(int));
+	}
+}
+
+/**
+ * FUNCTION NAME: restore
+ *
+ * DESCRIPTION: Replace the events with those saved by checkpoint
+ */
+int Scenario::restore(CheckpointReader *r) {
+	bool saved = r->get<bool>();
+	int n = r->get<int>();
+	if ( saved != loaded || n < 0 ) {
+		return FAILURE;
+	}
+	events.clear();
+	next = 0;
+	for ( int i = 0; i < n && r->ok(); i++ ) {
+		events.push_back(r->get<ScenarioEvent>());
+	}
+	sides.assign(max(0, r->get<int>()), vector<int>());
+	for ( unsigned int i = 0; i < sides.size() && r->ok(); i++ ) {
+		n = r->get<int>();
+		const char *ids = n >= 0 ? r->getBytes(n * sizeof(int)) : NULL;
+		if ( ids == NULL ) {
+			return FAILURE;
+		}
+		sides[i].assign((const int *)ids, (const int *)ids + n);
+	}
+	return r->ok() ? SUCCESS : FAILURE;
+}
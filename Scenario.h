@@ -0,0 +1,94 @@
+/**********************************
+ * FILE NAME: Scenario.h
+ *
+ * DESCRIPTION: Header file of the scripted failure and churn scenarios
+ **********************************/
+
+#ifndef _SCENARIO_H_
+#define _SCENARIO_H_
+
+#include "stdincludes.h"
+#include "Checkpoint.h"
+
+/**
+ * What a scenario step does to the group
+ */
+enum ScenarioEventType {
+	SCN_CRASH,		// stop a node, restarting it downtime ticks later if downtime is set
+	SCN_RACK,		// crash every node of a rack at once
+	SCN_RESTART,	// bring a crashed node back, as a fresh process under the same address
+	SCN_DROP,		// drop messages with probability prob from now on, 0 to stop
+	SCN_PARTITION,	// cut the links between the two sides of partition cut
+	SCN_HEAL		// restore every cut link
+};
+
+/**
+ * STRUCT NAME: ScenarioEvent
+ *
+ * DESCRIPTION: One step of a scenario, due at tick at
+ */
+typedef struct ScenarioEvent {
+	int at;
+	enum ScenarioEventType type;
+	// node id, or rack number for SCN_RACK, 0 to pick a running one at random when due
+	int node;
+	// nodes per rack, consecutive ids from 1
+	int rackSize;
+	// ticks until crashed nodes restart, 0 for never
+	int downtime;
+	double prob;
+	// SCN_PARTITION: which of the scenario's partitions, and whether only side 1 to side 2 is cut
+	int cut;
+	bool oneway;
+} ScenarioEvent;
+
+/**
+ * CLASS NAME: Scenario
+ *
+ * DESCRIPTION: Failure and churn script of a run, read from a file with one step per line:
+ *
+ * 				<tick>: crash <nodes> [<downtime>]
+ * 				<tick>: restart <nodes>
+ * 				<tick>: churn <nodes per tick> <until tick> [<downtime>]
+ * 				<tick>: rolling <nodes> <every> <downtime>
+ * 				<tick>: rack <size> <racks> [<downtime>]
+ * 				<tick>: drop <probability>
+ * 				<tick>: partition <nodes> [<nodes>] [oneway]
+ * 				<tick>: heal
+ *
+ * 				<nodes> and <racks> are ids and ranges like 3,5,10-19, numbered from 1,
+ * 				or "random <n>" for n picked among those running when the step is due.
+ * 				churn crashes random nodes at a fractional rate every tick until the
+ * 				until tick; rolling crashes the nodes one after the other, every
+ * 				<every> ticks. Racks group <size> consecutive ids. partition cuts
+ * 				the first nodes off from the second, everyone else if they are left
+ * 				out, and with oneway only drops what the first send to the second;
+ * 				heal lifts every partition. # starts a comment.
+ * 				Steps are expanded into single events when the file is loaded; the
+ * 				restarts of crashed nodes are added as the crashes happen.
+ */
+class Scenario {
+private:
+	// events sorted by tick, in the order they were added within a tick
+	vector<ScenarioEvent> events;
+	// first event not taken yet
+	unsigned int next;
+	bool loaded;
+	// both sides of each partition step, one after the other, an empty second side meaning the rest
+	vector<vector<int> > sides;
+	int parseIds(const char *spec, int limit, vector<int> &ids);
+	bool parseStep(int at, const char *action, const char *args, int nodes);
+public:
+	Scenario();
+	virtual ~Scenario() {}
+	int load(const char *path, int nodes);
+	bool active() const { return loaded; }
+	void schedule(const ScenarioEvent &e);
+	int take(int now, vector<ScenarioEvent> &due);
+	int nextTick() const;
+	const vector<int> &side(int cut, int k) const { return sides[2 * cut + k]; }
+	void checkpoint(CheckpointWriter *w);
+	int restore(CheckpointReader *r);
+};
+
+#endif /* _SCENARIO_H_ */
@@ -0,0 +1,167 @@
+/**********************************
+ * FILE NAME: Snapshot.h
+ *
+ * DESCRIPTION: Header file for the copy-on-write membership snapshots
+ **********************************/
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/*
+ * Macros
+ */
+// readers that can be inside a read section at once
+#define EPOCH_SLOTS 64
+
+/**
+ * Class name: EpochDomain
+ *
+ * Description: Epoch based reclamation shared by every RcuCell. A reader pins the
+ * 				current epoch in a free slot for the few instructions it needs the
+ * 				published pointer; whatever a writer unpublished at epoch r may be
+ * 				freed once no slot holds an epoch of r or less.
+ */
+class EpochDomain {
+private:
+	atomic<unsigned long> global;
+	atomic<unsigned long> slots[EPOCH_SLOTS];
+	EpochDomain() {
+		global.store(1);
+		for (int i = 0; i < EPOCH_SLOTS; i++) {
+			slots[i].store(0);
+		}
+	}
+public:
+	static EpochDomain &instance() {
+		static EpochDomain domain;
+		return domain;
+	}
+	/**
+	 * Pin the current epoch, returning the slot to leave
+	 */
+	int enter() {
+		for (;;) {
+			for (int i = 0; i < EPOCH_SLOTS; i++) {
+				unsigned long idle = 0;
+				if (slots[i].load(memory_order_relaxed) == 0 && slots[i].compare_exchange_strong(idle, global.load())) {
+					return i;
+				}
+			}
+			this_thread::yield();
+		}
+	}
+	void leave(int slot) { slots[slot].store(0, memory_order_release); }
+	/**
+	 * Epoch stamp of something a writer has just unpublished
+	 */
+	unsigned long retire() { return global.fetch_add(1); }
+	/**
+	 * Whether no reader can still hold what was retired at epoch r
+	 */
+	bool quiescent(unsigned long r) {
+		for (int i = 0; i < EPOCH_SLOTS; i++) {
+			unsigned long pinned = slots[i].load();
+			if (pinned != 0 && pinned <= r) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * Class name: RcuCell
+ *
+ * Description: Published reference counted value. Readers on any thread take a
+ * 				shared_ptr to the current value without locking or copying it;
+ * 				a single writer swaps in new values, and the cells holding old
+ * 				ones are freed once no reader can be looking at them. The values
+ * 				themselves live as long as someone holds a reference.
+ */
+template <typename T>
+class RcuCell {
+private:
+	atomic<shared_ptr<const T> *> current;
+	// unpublished cells and the epoch they were retired at, writer only
+	vector<pair<unsigned long, shared_ptr<const T> *>> retired;
+	RcuCell(const RcuCell &);
+	RcuCell &operator = (const RcuCell &);
+	void reclaim() {
+		EpochDomain &domain = EpochDomain::instance();
+		unsigned int k = 0;
+		for (unsigned int i = 0; i < retired.size(); i++) {
+			if (domain.quiescent(retired[i].first)) {
+				delete retired[i].second;
+			}
+			else {
+				retired[k++] = retired[i];
+			}
+		}
+		retired.resize(k);
+	}
+public:
+	RcuCell() : current(new shared_ptr<const T>()) {}
+	~RcuCell() {
+		delete current.load();
+		for (unsigned int i = 0; i < retired.size(); i++) {
+			delete retired[i].second;
+		}
+	}
+	/**
+	 * Current value, from any thread
+	 */
+	shared_ptr<const T> load() const {
+		EpochDomain &domain = EpochDomain::instance();
+		int slot = domain.enter();
+		shared_ptr<const T> value = *current.load();
+		domain.leave(slot);
+		return value;
+	}
+	/**
+	 * Replace the value, writer only
+	 */
+	void publish(const shared_ptr<const T> &value) {
+		shared_ptr<const T> *old = current.exchange(new shared_ptr<const T>(value));
+		retired.push_back(make_pair(EpochDomain::instance().retire(), old));
+		reclaim();
+	}
+};
+
+/**
+ * CLASS NAME: MembershipSnapshot
+ *
+ * DESCRIPTION: Immutable copy of a node's member list, sorted by member key.
+ * 				Heartbeats and timestamps are those of the moment it was published.
+ */
+class MembershipSnapshot {
+public:
+	const vector<MemberListEntry> members;
+	// the list's membershipChanges() and the time it was published at
+	const unsigned long version;
+	const long time;
+	MembershipSnapshot(const MemberTable &table, long time) :
+		members(table.entries()), version(table.membershipChanges()), time(time) {}
+	int size() const { return members.size(); }
+	bool contains(int id, short port) const {
+		MemberKey key = memberKey(id, port);
+		int lo = 0, hi = members.size();
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (memberKey(members[mid].id, members[mid].port) < key) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		return lo < (int)members.size() && memberKey(members[lo].id, members[lo].port) == key;
+	}
+};
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,220 @@
+/**********************************
+ * FILE NAME: Sweep.cpp
+ *
+ * DESCRIPTION: Definition of the in-process parameter sweep runner
+ **********************************/
+
+#include "Sweep.h"
+#include "Application.h"
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <sys/stat.h>
+
+/**
+ * FUNCTION NAME: makeDirs
+ *
+ * DESCRIPTION: mkdir -p
+ */
+static int makeDirs(const string &path) {
+	for ( size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1) ) {
+		string prefix = path.substr(0, pos);
+		if ( mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST ) {
+			return FAILURE;
+		}
+		if ( pos == string::npos ) {
+			break;
+		}
+	}
+	return SUCCESS;
+}
+
+/**
+ * Constructor
+ */
+Sweep::Sweep(char *sweepfile): outroot("sweep"), seeds(1), firstSeed(1), threads(0), nextRun(0) {
+	FILE *fp = fopen(sweepfile, "r");
+	char line[1024];
+	char key[256];
+	char value[768];
+	int i, j;
+
+	if ( fp == NULL ) {
+		fprintf(stderr, "Unable to open sweep file %s\n", sweepfile);
+		exit(1);
+	}
+
+	while ( fgets(line, sizeof(line), fp) != NULL ) {
+		if ( sscanf(line, " %255[^: \t] : %767[^\n]", key, value) != 2 ) {
+			continue;
+		}
+		if ( !strcmp(key, "SEEDS") ) {
+			seeds = atoi(value);
+		}
+		else if ( !strcmp(key, "FIRST_SEED") ) {
+			firstSeed = (unsigned int)strtoul(value, NULL, 10);
+		}
+		else if ( !strcmp(key, "THREADS") ) {
+			threads = atoi(value);
+		}
+		else if ( !strcmp(key, "OUTDIR") ) {
+			istringstream in(value);
+			in >> outroot;
+		}
+		else {
+			istringstream in(value);
+			vector<string> values;
+			string v;
+			while ( in >> v ) {
+				values.push_back(v);
+			}
+			axes.push_back(make_pair(string(key), values));
+		}
+	}
+	fclose(fp);
+
+	if ( threads <= 0 ) {
+		threads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+	}
+
+	// Expand the cartesian product of all the swept keys, once per seed
+	int configs = 1;
+	for ( i = 0; i < (int)axes.size(); i++ ) {
+		configs *= axes[i].second.size();
+	}
+	for ( i = 0; i < configs; i++ ) {
+		vector<pair<string, string>> settings;
+		int rest = i;
+		for ( j = (int)axes.size() - 1; j >= 0; j-- ) {
+			int n = axes[j].second.size();
+			settings.insert(settings.begin(), make_pair(axes[j].first, axes[j].second[rest % n]));
+			rest /= n;
+		}
+		for ( j = 0; j < seeds; j++ ) {
+			SweepRun r;
+			char dir[64];
+			r.config = i;
+			r.seed = firstSeed + j;
+			r.settings = settings;
+			sprintf(dir, "/run_%05d", (int)runs.size());
+			r.outdir = outroot + dir;
+			r.liveMissing = 0;
+			r.deadPresent = 0;
+			r.seconds = 0;
+			runs.push_back(r);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Run all the configurations on the thread pool and write the summary
+ */
+int Sweep::run() {
+	int i;
+	vector<thread> pool;
+
+	if ( makeDirs(outroot) != SUCCESS ) {
+		fprintf(stderr, "Unable to create %s\n", outroot.c_str());
+		return FAILURE;
+	}
+	printf("Sweep: %d runs on %d threads into %s\n", (int)runs.size(), threads, outroot.c_str());
+
+	for ( i = 0; i < threads; i++ ) {
+		pool.push_back(thread(&Sweep::worker, this));
+	}
+	for ( i = 0; i < threads; i++ ) {
+		pool[i].join();
+	}
+
+	writeSummary();
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: worker
+ *
+ * DESCRIPTION: Thread pool worker, claims runs until none are left
+ */
+void Sweep::worker() {
+	int i;
+	while ( (i = nextRun++) < (int)runs.size() ) {
+		runOne(&runs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: runOne
+ *
+ * DESCRIPTION: Run one Application with its own parameters, seed and output directory
+ */
+void Sweep::runOne(SweepRun *r) {
+	Params *p = new Params();
+	unsigned int i;
+
+	for ( i = 0; i < r->settings.size(); i++ ) {
+		if ( !p->setparam(r->settings[i].first.c_str(), r->settings[i].second.c_str()) ) {
+			fprintf(stderr, "Unknown parameter %s in sweep\n", r->settings[i].first.c_str());
+		}
+	}
+	p->SEED = r->seed;
+	p->VERBOSE = 0;
+	p->OUTDIR = r->outdir;
+	p->finalize();
+	makeDirs(r->outdir);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	Application *app = new Application(p);
+	app->run();
+	r->liveMissing = app->getLiveMissing();
+	r->deadPresent = app->getDeadPresent();
+	delete app;
+	r->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * FUNCTION NAME: writeSummary
+ *
+ * DESCRIPTION: Write one line per run and one aggregate per configuration to sweep.log
+ */
+void Sweep::writeSummary() {
+	unsigned int i, j;
+	string path = outroot + "/sweep.log";
+	FILE *fp = fopen(path.c_str(), "w");
+
+	if ( fp == NULL ) {
+		fprintf(stderr, "Unable to write %s\n", path.c_str());
+		return;
+	}
+
+	fprintf(fp, "# run config seed live_missing dead_present seconds settings\n");
+	for ( i = 0; i < runs.size(); i++ ) {
+		fprintf(fp, "%5u %4d %10u %6d %6d %8.3f", i, runs[i].config, runs[i].seed, runs[i].liveMissing, runs[i].deadPresent, runs[i].seconds);
+		for ( j = 0; j < runs[i].settings.size(); j++ ) {
+			fprintf(fp, " %s=%s", runs[i].settings[j].first.c_str(), runs[i].settings[j].second.c_str());
+		}
+		fprintf(fp, "\n");
+	}
+
+	// A run has a false positive if some live member ended up missing from a live view
+	fprintf(fp, "\n# config runs p_false_positive p_missed_failure mean_live_missing settings\n");
+	for ( i = 0; i < runs.size(); i += seeds ) {
+		int fp_runs = 0, miss_runs = 0;
+		double missing = 0;
+		for ( j = i; j < i + seeds; j++ ) {
+			fp_runs += runs[j].liveMissing > 0;
+			miss_runs += runs[j].deadPresent > 0;
+			missing += runs[j].liveMissing;
+		}
+		char line[256];
+		sprintf(line, "%4d %5d %8.4f %8.4f %10.3f", runs[i].config, seeds, (double)fp_runs / seeds, (double)miss_runs / seeds, missing / seeds);
+		string settings;
+		for ( j = 0; j < runs[i].settings.size(); j++ ) {
+			settings += " " + runs[i].settings[j].first + "=" + runs[i].settings[j].second;
+		}
+		fprintf(fp, "%s%s\n", line, settings.c_str());
+		printf("%s%s\n", line, settings.c_str());
+	}
+	fclose(fp);
+}
@@ -0,0 +1,58 @@
+/**********************************
+ * FILE NAME: Sweep.h
+ *
+ * DESCRIPTION: Header file of the in-process parameter sweep runner
+ **********************************/
+
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include <atomic>
+
+/**
+ * STRUCT NAME: SweepRun
+ *
+ * DESCRIPTION: One configuration/seed pair of the sweep and its outcome
+ */
+typedef struct SweepRun {
+	int config;
+	unsigned int seed;
+	// parameter overrides of this configuration
+	vector<pair<string, string>> settings;
+	string outdir;
+	int liveMissing;
+	int deadPresent;
+	double seconds;
+} SweepRun;
+
+/**
+ * CLASS NAME: Sweep
+ *
+ * DESCRIPTION: Runs many independent Applications on a thread pool.
+ * 				The sweep file uses the .conf format; a key given several
+ * 				whitespace separated values is swept over, and the cartesian
+ * 				product of all such keys is run once per seed.
+ * 				SEEDS, FIRST_SEED, THREADS and OUTDIR control the sweep itself.
+ */
+class Sweep {
+private:
+	string outroot;
+	int seeds;
+	unsigned int firstSeed;
+	int threads;
+	// every key of the sweep file and the values it takes
+	vector<pair<string, vector<string>>> axes;
+	vector<SweepRun> runs;
+	atomic<int> nextRun;
+	void worker();
+	void runOne(SweepRun *r);
+	void writeSummary();
+public:
+	Sweep(char *sweepfile);
+	virtual ~Sweep() {}
+	int run();
+};
+
+#endif /* _SWEEP_H_ */
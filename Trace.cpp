@@ -0,0 +1,134 @@
+/**********************************
+ * FILE NAME: Trace.cpp
+ *
+ * DESCRIPTION: Definition of the EmulNet traffic trace writer and reader
+ **********************************/
+
+#include "Trace.h"
+
+/**
+ * Destructor, cutting the file to the records written
+ */
+TraceWriter::~TraceWriter() {
+	close();
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Create a trace file and write its header
+ */
+int TraceWriter::open(const char *path, int nodes) {
+	pos = 0;
+	failed = false;
+	if ( file.openWrite(path, 1 << 20) != SUCCESS ) {
+		return FAILURE;
+	}
+	unsigned long long magic = TRACE_MAGIC;
+	int version = TRACE_VERSION;
+	putBytes(&magic, sizeof(magic));
+	putBytes(&version, sizeof(version));
+	putBytes(&nodes, sizeof(nodes));
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: putBytes
+ *
+ * DESCRIPTION: Append size bytes, doubling the mapping when it is full
+ */
+void TraceWriter::putBytes(const void *data, size_t size) {
+	if ( failed || !file.isOpen() ) {
+		return;
+	}
+	if ( pos + size > file.size() ) {
+		size_t newLength = file.size();
+		while ( pos + size > newLength ) {
+			newLength *= 2;
+		}
+		if ( file.resize(newLength) != SUCCESS ) {
+			failed = true;
+			return;
+		}
+	}
+	memcpy(file.data() + pos, data, size);
+	pos += size;
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Append one record, and its payload if it is a delivered receive
+ */
+void TraceWriter::append(const TraceRecord &rec, const char *payload) {
+	lock_guard<mutex> guard(appending);
+	putBytes(&rec, sizeof(TraceRecord));
+	if ( rec.event == TRACE_RECV && rec.outcome == TRACE_OK ) {
+		putBytes(payload, rec.size);
+	}
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Cut the file to the bytes written and unmap it
+ */
+int TraceWriter::close() {
+	if ( !file.isOpen() ) {
+		return failed ? FAILURE : SUCCESS;
+	}
+	if ( file.close(pos) != SUCCESS || failed ) {
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Map a trace file and check its header
+ */
+int TraceReader::open(const char *path) {
+	unsigned long long magic;
+	int version;
+	size_t header = sizeof(magic) + sizeof(version) + sizeof(nodes);
+
+	pos = 0;
+	if ( file.openRead(path) != SUCCESS || file.size() < header ) {
+		return FAILURE;
+	}
+	memcpy(&magic, file.data(), sizeof(magic));
+	memcpy(&version, file.data() + sizeof(magic), sizeof(version));
+	memcpy(&nodes, file.data() + sizeof(magic) + sizeof(version), sizeof(nodes));
+	if ( magic != TRACE_MAGIC || version != TRACE_VERSION ) {
+		return FAILURE;
+	}
+	pos = header;
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Read the next record. payload points into the mapping for a delivered
+ * 				receive and is NULL otherwise.
+ *
+ * RETURNS:
+ * false at the end of the trace or on a truncated record
+ */
+bool TraceReader::next(TraceRecord *rec, const char **payload) {
+	if ( pos + sizeof(TraceRecord) > file.size() ) {
+		return false;
+	}
+	memcpy(rec, file.data() + pos, sizeof(TraceRecord));
+	pos += sizeof(TraceRecord);
+	*payload = NULL;
+	if ( rec->event == TRACE_RECV && rec->outcome == TRACE_OK ) {
+		if ( rec->size < 0 || pos + rec->size > file.size() ) {
+			return false;
+		}
+		*payload = file.data() + pos;
+		pos += rec->size;
+	}
+	return true;
+}
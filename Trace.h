@@ -0,0 +1,102 @@
+/**********************************
+ * FILE NAME: Trace.h
+ *
+ * DESCRIPTION: Header file of the memory-mapped EmulNet traffic trace
+ **********************************/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "stdincludes.h"
+#include "MappedFile.h"
+
+#include <mutex>
+
+/*
+ * Macros
+ */
+#define TRACE_MAGIC 0x314543415254504dULL
+#define TRACE_VERSION 1
+
+/**
+ * What happened to a message
+ */
+enum TraceEvent {
+	TRACE_SEND,
+	TRACE_RECV
+};
+
+/**
+ * Outcome of a send or a receive, TRACE_OK meaning accepted or delivered
+ */
+enum TraceOutcome {
+	TRACE_OK,
+	TRACE_OVERFLOW,
+	TRACE_LOSS,
+	TRACE_BURST,
+	TRACE_QUEUE,
+	TRACE_FULL,
+	TRACE_EXPIRED,
+	TRACE_DEAD_LETTER,
+	TRACE_PARTITION
+};
+
+/**
+ * STRUCT NAME: TraceRecord
+ *
+ * DESCRIPTION: One trace event. A delivered receive is followed by its size payload bytes.
+ */
+typedef struct TraceRecord {
+	long long time;				// simtime, in TICK_UNITS
+	int from;
+	int to;
+	int type;					// first int of the payload, the message type
+	int size;
+	char event;					// a TraceEvent
+	char outcome;				// a TraceOutcome
+	short pad;
+	int pad2;
+} TraceRecord;
+
+/**
+ * CLASS NAME: TraceWriter
+ *
+ * DESCRIPTION: Appends trace records to a memory-mapped file. Used by one
+ * 				EmulNet; records of concurrent senders are appended one at a time.
+ */
+class TraceWriter {
+private:
+	MappedFile file;
+	size_t pos;
+	bool failed;
+	mutex appending;
+	void putBytes(const void *data, size_t size);
+public:
+	TraceWriter(): pos(0), failed(false) {}
+	virtual ~TraceWriter();
+	int open(const char *path, int nodes);
+	void append(const TraceRecord &rec, const char *payload);
+	int close();
+};
+
+/**
+ * CLASS NAME: TraceReader
+ *
+ * DESCRIPTION: Walks the records of a trace straight from the mapping
+ */
+class TraceReader {
+private:
+	MappedFile file;
+	size_t pos;
+	int nodes;
+public:
+	TraceReader(): pos(0), nodes(0) {}
+	virtual ~TraceReader() {}
+	int open(const char *path);
+	int nodeCount() {
+		return nodes;
+	}
+	bool next(TraceRecord *rec, const char **payload);
+};
+
+#endif /* _TRACE_H_ */